@@ -0,0 +1,126 @@
+"""
+Compile per-node TSCH xml schedules (e.g. generated by schedule_generator_v2.py)
+into a single binary schedule file, loaded by TschSlotframe when its fileName
+ends with ".tsb" (or scheduleFormat = "binary"). Each node selects its own
+schedule by scheduleIndex, which is the position of its xml file on the command line.
+
+Usage:
+    python3 schedule_compiler.py -o schedules.tsb host_0.xml host_1.xml ... sink.xml
+    python3 schedule_compiler.py -o schedules.tsb --dir ./blacklisted-2
+
+With --dir, host_<i>.xml files are taken in index order followed by sink.xml,
+so host[i] uses scheduleIndex = i and the sink scheduleIndex = number of hosts.
+
+File layout (little-endian), must match TschBinaryParser.h:
+    header     magic "TSCB", uint32 version, numSchedules, numSlotframes, numLinks
+    schedules  {uint32 firstSlotframe, numSlotframes}
+    slotframes {int32 handle, macSlotframeSize, uint32 firstLink, numLinks}
+    links      {uint16 slotOffset, channelOffset, options, int16 virtualId, uint64 neighbor}
+"""
+
+import argparse
+import os
+import re
+import struct
+import xml.etree.ElementTree as ET
+
+VERSION = 1
+
+OPT_TX = 1 << 0
+OPT_RX = 1 << 1
+OPT_SHARED = 1 << 2
+OPT_TIMEKEEPING = 1 << 3
+OPT_NORMAL = 1 << 4
+OPT_ADVERTISING = 1 << 5
+OPT_ADVERTISINGONLY = 1 << 6
+
+def mac_to_int(mac_hex):
+    return int(mac_hex.translate(mac_hex.maketrans("", "", ":.- ")), 16)
+
+def bool_attr(elem, attr, default):
+    if elem is None or elem.get(attr) is None:
+        return default
+    return elem.get(attr) == "true"
+
+def int_attr(elem, attr, default):
+    if elem is None or elem.get(attr) is None:
+        return default
+    return int(elem.get(attr))
+
+def link_options(link):
+    opt = link.find("Option")
+    ltype = link.find("Type")
+    flags = [
+        (bool_attr(opt, "tx", True), OPT_TX),
+        (bool_attr(opt, "rx", True), OPT_RX),
+        (bool_attr(opt, "shared", True), OPT_SHARED),
+        (bool_attr(opt, "timekeeping", False), OPT_TIMEKEEPING),
+        (bool_attr(ltype, "normal", True), OPT_NORMAL),
+        (bool_attr(ltype, "advertising", False), OPT_ADVERTISING),
+        (bool_attr(ltype, "advertisingOnly", False), OPT_ADVERTISINGONLY),
+    ]
+    return sum(bit for is_set, bit in flags if is_set)
+
+def link_neighbor(link):
+    nbr = link.find("Neighbor")
+    address = nbr.get("address") if nbr is not None else None
+    return mac_to_int(address) if address else 0
+
+def compile_schedules(xml_files, out_file):
+    schedules, slotframes, links = [], [], []
+
+    for xml_file in xml_files:
+        root = ET.parse(xml_file).getroot()
+        if root.tag != "TSCHSchedule":
+            raise ValueError(f"{xml_file}: unknown root element <{root.tag}>")
+
+        schedules.append((len(slotframes), len(root.findall("Slotframe"))))
+        for sf in root.findall("Slotframe"):
+            sf_links = sf.findall("Link")
+            slotframes.append((int_attr(sf, "handle", 0), int_attr(sf, "macSlotframeSize", 0), len(links), len(sf_links)))
+            for l in sf_links:
+                links.append((int_attr(l, "slotOffset", 0), int_attr(l, "channelOffset", 0), link_options(l),
+                              int_attr(l.find("Virtual"), "id", -2), link_neighbor(l)))
+
+    with open(out_file, "wb") as f:
+        f.write(struct.pack("<4sIIII", b"TSCB", VERSION, len(schedules), len(slotframes), len(links)))
+        for s in schedules:
+            f.write(struct.pack("<II", *s))
+        for sf in slotframes:
+            f.write(struct.pack("<iiII", *sf))
+        for l in links:
+            f.write(struct.pack("<HHHhQ", *l))
+
+    return schedules
+
+def files_in_dir(folder):
+    hosts = {}
+    for name in os.listdir(folder):
+        m = re.fullmatch(r"host_(\d+)\.xml", name)
+        if m:
+            hosts[int(m.group(1))] = os.path.join(folder, name)
+
+    if sorted(hosts) != list(range(len(hosts))):
+        raise ValueError(f"{folder}: host_<i>.xml files are not numbered contiguously from 0")
+
+    files = [hosts[i] for i in range(len(hosts))]
+    sink = os.path.join(folder, "sink.xml")
+    if os.path.exists(sink):
+        files.append(sink)
+    return files
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Compile TSCH xml schedules into one binary schedule file")
+    parser.add_argument("-o", "--output", required=True, help="binary schedule file to write (.tsb)")
+    parser.add_argument("--dir", help="folder with host_<i>.xml and sink.xml as written by schedule_generator_v2.py")
+    parser.add_argument("xml_files", nargs="*", help="xml schedules, in scheduleIndex order")
+    args = parser.parse_args()
+
+    xml_files = (files_in_dir(args.dir) if args.dir else []) + args.xml_files
+    if not xml_files:
+        parser.error("no xml schedules given")
+
+    schedules = compile_schedules(xml_files, args.output)
+    for i, xml_file in enumerate(xml_files):
+        print(f"scheduleIndex {i}: {xml_file} ({schedules[i][1]} slotframe(s))")
+    print(f"Written {len(schedules)} schedules to {args.output}")
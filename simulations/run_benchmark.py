@@ -0,0 +1,155 @@
+"""
+Run the simulator performance benchmarks of benchmark.ini and record per run
+wall-clock time, init time, events/s and peak memory (RSS) to a CSV file.
+Optionally compare the results against a stored baseline to catch regressions.
+
+Usage (from the simulations folder, after building src/tsch):
+    python3 run_benchmark.py -o results.csv
+    python3 run_benchmark.py -o results.csv --baseline benchmark_baseline.csv
+    python3 run_benchmark.py -o benchmark_baseline.csv --sizes 10 50      # (re)create a baseline
+
+Extra arguments after "--" are passed to the simulation executable, e.g. to load
+INET / RPL libraries and NED folders:
+    python3 run_benchmark.py -o results.csv -- -l ../../inet4/src/INET -n ../../inet4/src
+
+Init time is the wall-clock time of the same run with a zero simulation time limit
+(network setup, initialize() and finish()). Events/s are measured over the remaining time.
+Runs are sequential, as concurrent runs would skew each other's timing.
+"""
+
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+import time
+
+CONFIGS = ["BenchmarkGeneric", "BenchmarkHighDensity"]
+FIELDS = ["config", "numHosts", "run", "simTime", "events", "wallTime", "initTime", "eventsPerSec", "peakRssKb"]
+
+# tolerated relative change before a metric is reported as a regression
+DEFAULT_TOLERANCE = 0.1
+# changes of wall-clock times below this many seconds are noise, never a regression
+MIN_TIME_CHANGE = 0.1
+
+def opp_command(args, config, run=None, extra=()):
+    cmd = [args.exe, "-u", "Cmdenv", "-f", args.ini, "-n", args.ned_path, "-c", config]
+    if run is not None:
+        cmd += ["-r", str(run)]
+    return cmd + list(extra) + args.opp_args
+
+def list_runs(args, config):
+    """ Map run numbers of a config to their network size, parsed from `-q runs` """
+    out = subprocess.run(opp_command(args, config, extra=["-q", "runs"]), stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT, universal_newlines=True, check=True).stdout
+    runs = {}
+    for line in out.splitlines():
+        m = re.match(r"\s*Run (\d+):.*\$N=(\d+)", line)
+        if m:
+            runs[int(m.group(1))] = int(m.group(2))
+    return runs
+
+def execute(cmd):
+    """ Run cmd, return its output, wall-clock time and peak RSS in kB """
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    out = proc.stdout.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+    proc.returncode = os.waitstatus_to_exitcode(status) if hasattr(os, "waitstatus_to_exitcode") else status >> 8
+
+    if proc.returncode != 0:
+        sys.exit(f"Simulation failed ({' '.join(cmd)}):\n{out}")
+    return out, wall, usage.ru_maxrss
+
+def run_benchmark(args, config, run, num_hosts):
+    _, init_time, _ = execute(opp_command(args, config, run, ["--sim-time-limit=0s"]))
+    out, wall, peak_rss = execute(opp_command(args, config, run))
+
+    # e.g. "<!> Simulation time limit reached -- at t=600s, event #1234567"
+    m = re.search(r"at t=([\d.e+-]+)s, event #(\d+)", out)
+    if not m:
+        sys.exit(f"Could not find the event count in the output of {config} run {run}:\n{out}")
+    sim_time, events = float(m.group(1)), int(m.group(2))
+
+    run_time = max(wall - init_time, 1e-9)
+    return {
+        "config": config,
+        "numHosts": num_hosts,
+        "run": run,
+        "simTime": sim_time,
+        "events": events,
+        "wallTime": round(wall, 3),
+        "initTime": round(init_time, 3),
+        "eventsPerSec": round(events / run_time, 1),
+        "peakRssKb": peak_rss,
+    }
+
+def compare(results, baseline_file, tolerance):
+    """ Print the change of each metric against the baseline, return the number of regressions """
+    with open(baseline_file) as f:
+        baseline = {(r["config"], r["numHosts"]): r for r in csv.DictReader(f)}
+
+    # metric, True if higher is better, True if it's a time in seconds
+    metrics = [("eventsPerSec", True, False), ("wallTime", False, True), ("initTime", False, True),
+               ("peakRssKb", False, False)]
+    regressions = 0
+
+    for r in results:
+        base = baseline.get((r["config"], str(r["numHosts"])))
+        if base is None:
+            print(f"{r['config']} N={r['numHosts']}: no baseline")
+            continue
+
+        if int(base["events"]) != r["events"]:
+            print(f"{r['config']} N={r['numHosts']}: event count changed "
+                  f"({base['events']} -> {r['events']}), model behavior differs from the baseline")
+
+        for metric, higher_is_better, is_time in metrics:
+            old, new = float(base[metric]), float(r[metric])
+            if old <= 0:
+                continue
+            change = (new - old) / old
+            worse = -change if higher_is_better else change
+            noise = is_time and abs(new - old) < MIN_TIME_CHANGE
+            flag = "REGRESSION" if worse > tolerance and not noise else ""
+            regressions += bool(flag)
+            print(f"{r['config']} N={r['numHosts']} {metric}: {old:g} -> {new:g} ({change:+.1%}) {flag}")
+
+    return regressions
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Run the TSCH simulator performance benchmarks")
+    parser.add_argument("-o", "--output", default="benchmark_results.csv", help="CSV file to write the results to")
+    parser.add_argument("--baseline", help="CSV file written by an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=DEFAULT_TOLERANCE,
+                        help="relative change of a metric reported as regression (default %(default)s)")
+    parser.add_argument("--configs", nargs="+", default=CONFIGS, help="configs of benchmark.ini to run")
+    parser.add_argument("--sizes", nargs="+", type=int, help="only run these network sizes")
+    parser.add_argument("--exe", default="../src/tsch", help="simulation executable")
+    parser.add_argument("--ini", default="benchmark.ini")
+    parser.add_argument("--ned-path", default="../src:.")
+    parser.add_argument("opp_args", nargs=argparse.REMAINDER, help="-- followed by extra simulation arguments")
+    args = parser.parse_args()
+    args.opp_args = args.opp_args[1:] if args.opp_args[:1] == ["--"] else args.opp_args
+
+    results = []
+    for config in args.configs:
+        for run, num_hosts in sorted(list_runs(args, config).items()):
+            if args.sizes and num_hosts not in args.sizes:
+                continue
+            print(f"Running {config} N={num_hosts} (run {run})...", flush=True)
+            results.append(run_benchmark(args, config, run, num_hosts))
+            print("    " + ", ".join(f"{k}={results[-1][k]}" for k in FIELDS[3:]), flush=True)
+
+    with open(args.output, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(results)
+    print(f"Written {len(results)} results to {args.output}")
+
+    if args.baseline:
+        num_regressions = compare(results, args.baseline, args.tolerance)
+        if num_regressions:
+            sys.exit(f"{num_regressions} regression(s) against {args.baseline}")
@@ -22,6 +22,7 @@
 
 
 #include "TschPingApp.h"
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include <iostream>
 #include "inet/applications/pingapp/PingApp.h"
@@ -202,6 +203,7 @@ void TschPingApp::sendPingRequest()
     /// Make changes here //////
     auto tag = outPacket->addTagIfAbsent<VirtualLinkTagReq>();
     tag->setVirtualLinkID(virtualLinkID);
+    outPacket->addTag<TrafficClassTag>()->setTrafficClass(TC_APP);
     if (hopLimit != -1)
         outPacket->addTagIfAbsent<HopLimitReq>()->setHopLimit(hopLimit);
     EV_INFO << "Sending ping request #" << sendSeqNo << " to lower layer.\n";
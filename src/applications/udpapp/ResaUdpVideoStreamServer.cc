@@ -24,6 +24,7 @@
 #include "inet/transportlayer/common/L4PortTag_m.h"
 #include "inet/transportlayer/contract/udp/UdpControlInfo_m.h"
 #include "ResaUdpVideoStreamServer.h"
+#include "../../common/TrafficClassTag_m.h"
 
 
 using namespace inet;
@@ -42,6 +43,7 @@ void ResaUdpVideoStreamServer::sendStreamData(cMessage *timer)
 
     // generate and send a packet
     Packet *pkt = new Packet("VideoStrmPk");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP);
     long pktLen = *packetLen;
 
     if (pktLen > d->bytesLeft)
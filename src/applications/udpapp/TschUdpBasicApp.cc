@@ -19,6 +19,7 @@
 //  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "TschUdpBasicApp.h"
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include <iostream>
 #include "inet/applications/base/ApplicationPacket_m.h"
@@ -78,6 +79,7 @@ void TschUdpBasicApp::sendPacket() {
         packet->addTagIfAbsent<FragmentationReq>()->setDontFragment(true);
     auto tag = packet->addTagIfAbsent<VirtualLinkTagReq>();
     tag->setVirtualLinkID(virtualLinkId);
+    packet->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP);
     const auto& payload = makeShared<ApplicationPacket>();
     payload->setChunkLength(B(par("messageLength")));
     payload->setSequenceNumber(numSent);
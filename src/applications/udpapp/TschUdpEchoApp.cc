@@ -19,6 +19,7 @@
 //  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "TschUdpEchoApp.h"
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include "inet/applications/udpapp/UdpEchoApp.h"
 #include "inet/common/ModuleAccess.h"
@@ -64,6 +65,7 @@ void TschUdpEchoApp::socketDataArrived(UdpSocket *socket, Packet *pk)
     if (virtualLinkTagInd != nullptr){
         pk->addTagIfAbsent<VirtualLinkTagReq>()->setVirtualLinkID(virtualLinkID);
     }
+    pk->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP);
 
     // send back
 
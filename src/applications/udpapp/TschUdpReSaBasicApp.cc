@@ -20,6 +20,7 @@
 
 #include "TschUdpReSaBasicApp.h"
 
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include <iostream>
 #include "inet/applications/base/ApplicationPacket_m.h"
@@ -65,6 +66,7 @@ void TschUdpReSaBasicApp::initialize(int stage){
             packetName = par("packetName");
             dontFragment = par("dontFragment");
             virtualLinkId = par("virtualLinkId");
+            hazard = par("hazard");
             if (stopTime >= SIMTIME_ZERO && stopTime < startTime)
                 throw cRuntimeError("Invalid startTime/stopTime parameters");
             selfMsg = new cMessage("sendTimer");
@@ -89,6 +91,7 @@ void TschUdpReSaBasicApp::sendPacket(){
         packet->addTagIfAbsent<FragmentationReq>()->setDontFragment(true);
     auto tag = packet->addTagIfAbsent<VirtualLinkTagReq>();
     tag->setVirtualLinkID(virtualLinkId);
+    packet->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP | (hazard ? TC_HAZARD : TC_NONE));
     const auto& payload = makeShared<ApplicationPacket>();
     payload->setChunkLength(B(par("messageLength")));
     payload->setSequenceNumber(moduleIndex_int);
@@ -42,6 +42,7 @@ protected:
     virtual void initialize(int stage) override;
 private:
     int virtualLinkId;
+    bool hazard; // smoke alarm traffic, see TC_HAZARD
 };
 }
 
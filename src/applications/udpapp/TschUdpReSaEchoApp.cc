@@ -20,6 +20,7 @@
 
 #include "TschUdpReSaEchoApp.h"
 
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include "inet/applications/base/ApplicationPacket_m.h"
 #include "inet/applications/udpapp/UdpEchoApp.h"
@@ -128,6 +129,8 @@ void TschUdpReSaEchoApp::forwardPacket(UdpSocket *socket, Packet *packet, L3Addr
     payload->setSequenceNumber(moduleIndex_int);
     payload->addTag<CreationTimeTag>()->setCreationTime(packet->getCreationTime());
     echopacket->addTagIfAbsent<VirtualLinkTagReq>()->setVirtualLinkID(par("virtualLinkId").intValue());
+    // only smoke alarms are forwarded to the analytical modules
+    echopacket->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP | TC_HAZARD);
     echopacket->insertAtBack(payload);
     emit(packetSentSignal, echopacket);
 
@@ -19,6 +19,7 @@
 //  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "UdpBurstApp.h"
+#include "../../common/TrafficClassTag_m.h"
 #include "../../common/VirtualLinkTag_m.h"
 #include <iostream>
 #include "inet/applications/base/ApplicationPacket_m.h"
@@ -119,6 +120,25 @@ void UdpBurstApp::processSendBurst()
     }
 }
 
+void UdpBurstApp::sendPacket()
+{
+    std::ostringstream str;
+    str << packetName << "-" << numSent;
+    Packet *packet = new Packet(str.str().c_str());
+    if (dontFragment)
+        packet->addTagIfAbsent<FragmentationReq>()->setDontFragment(true);
+    packet->addTag<TrafficClassTag>()->setTrafficClass(TC_APP | TC_UDP | TC_BURSTY);
+    const auto& payload = makeShared<ApplicationPacket>();
+    payload->setChunkLength(B(par("messageLength")));
+    payload->setSequenceNumber(numSent);
+    payload->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    packet->insertAtBack(payload);
+    L3Address destAddr = chooseDestAddr();
+    emit(packetSentSignal, packet);
+    socket.sendTo(packet, destAddr, destPort);
+    numSent++;
+}
+
 void UdpBurstApp::handleMessageWhenUp(cMessage *msg)
 {
     if (msg->isSelfMessage()) {
@@ -42,6 +42,7 @@ class UdpBurstApp: public inet::UdpBasicApp {
         virtual void initialize(int stage) override;
         virtual void finish() override;
         virtual void processSend() override;
+        virtual void sendPacket() override;
         virtual void handleMessageWhenUp(cMessage *msg) override;
 
         virtual void processSendBurst();
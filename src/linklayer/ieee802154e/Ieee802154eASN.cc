@@ -27,16 +27,21 @@ Ieee802154eASN::Ieee802154eASN()
     , reference(0)
     , asn_reference(0)
     , macTsTimeslotLength(0)
+    , slotTicks(0)
 {
     // TODO Auto-generated constructor stub
 
 }
 
 int64_t Ieee802154eASN::getAsn(omnetpp::simtime_t at) const {
-    double passed = SIMTIME_DBL(at - getReference());
-    assert(passed >= 0);
+    int64_t passed = (at - getReference()).raw();
+    assert(passed >= 0 && slotTicks > 0);
 
-    return (int64_t) ((passed / macTsTimeslotLength) + SIMTIME_DBL(reference));
+    return asn_reference + passed / slotTicks;
+}
+
+omnetpp::simtime_t Ieee802154eASN::getAsnTime(int64_t asn) const {
+    return reference + (asn - asn_reference) * macTsTimeslotLength;
 }
 
 int64_t Ieee802154eASN::getAsnReference() const {
@@ -58,6 +63,7 @@ const omnetpp::simtime_t& Ieee802154eASN::getMacTsTimeslotLength() const {
 void Ieee802154eASN::setMacTsTimeslotLength(
         const omnetpp::simtime_t& macTsTimeslotLength) {
     this->macTsTimeslotLength = macTsTimeslotLength;
+    this->slotTicks = macTsTimeslotLength.raw();
 }
 
 void Ieee802154eASN::setReference(omnetpp::simtime_t reference) {
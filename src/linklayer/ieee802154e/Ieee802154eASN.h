@@ -24,6 +24,11 @@
 
 #include <omnetpp.h>
 
+/**
+ * Conversion between simulation time and absolute slot numbers (ASN).
+ * Slot number asn_reference starts at time reference, all arithmetic is done
+ * in raw simtime ticks, so slot boundaries stay exact for arbitrarily long runs.
+ */
 class Ieee802154eASN
 {
     private:
@@ -31,11 +36,15 @@ class Ieee802154eASN
         omnetpp::simtime_t reference;
         int64_t asn_reference;
         omnetpp::simtime_t macTsTimeslotLength;
+        int64_t slotTicks; // macTsTimeslotLength in raw simtime ticks
 
     public:
         Ieee802154eASN();
         virtual ~Ieee802154eASN();
+        /** ASN of the slot running at @p at, which must not be before the reference */
         int64_t getAsn(omnetpp::simtime_t at) const;
+        /** Start time of slot @p asn */
+        omnetpp::simtime_t getAsnTime(int64_t asn) const;
         int64_t getAsnReference() const;
         void setAsnReference(int64_t asnReference);
         omnetpp::simtime_t getReference() const;
@@ -49,6 +49,13 @@
 #include "inet/physicallayer/common/packetlevel/RadioMedium.h"
 #include "./sixtisch/SixpHeaderChunk_m.h"
 #include "../../common/VirtualLinkTag_m.h"
+#include "../../common/TrafficClassTag_m.h"
+#include "../../common/TschSimsignals.h"
+
+#ifdef WITH_IPv6
+#include "inet/networklayer/icmpv6/Icmpv6Header_m.h"
+#include "inet/networklayer/ipv6/Ipv6Header.h"
+#endif // ifdef WITH_IPv6
 
 
 namespace tsch {
@@ -59,6 +66,18 @@ using namespace inet;
 
 Define_Module(Ieee802154eMac);
 
+/** Names of t_mac_states and t_mac_event values, indexed by value, for the FSM profiling table */
+static const std::vector<std::string> macStateNames = {
+        "", "IDLE_1", "HOPPING_2", "CCA_3", "TRANSMITFRAME_4", "WAITACK_5",
+        "RECEIVEFRAME_6", "WAITSIFS_7", "TRANSMITACK_8"
+};
+static const std::vector<std::string> macEventNames = {
+        "", "EV_SEND_REQUEST", "EV_TIMER_BACKOFF", "EV_FRAME_TRANSMITTED", "EV_ACK_RECEIVED",
+        "EV_ACK_TIMEOUT", "EV_FRAME_RECEIVED", "EV_DUPLICATE_RECEIVED", "EV_TIMER_SIFS",
+        "EV_BROADCAST_RECEIVED", "EV_TIMER_CCA", "EV_TIMER_SLOT", "EV_TIMER_HOPPING",
+        "EV_TIMER_SLOTEND", "MAC_ENABLE_DROPS"
+};
+
 void Ieee802154eMac::initialize(int stage) {
     inet::MacProtocolBase::initialize(stage);
     if (stage == INITSTAGE_LOCAL) {
@@ -67,6 +86,8 @@ void Ieee802154eMac::initialize(int stage) {
         //sixTopSublayerControlInGateId = findGate("sixTopSublayerControlInGate");
         sixTopSublayerControlOutGateId = findGate("sixTopSublayerControlOutGate");
         useMACAcks = par("useMACAcks");
+        SeqNrParent.configure(par("seqNumTableSize"), 0);
+        SeqNrChild.configure(par("seqNumTableSize"), par("seqNumReorderWindow"));
         macTsTxAckDelay = par("macTsTxAckDelay");
         macTsTimeslotLength = par("macTsTimeslotLength");
         headerLength = par("headerLength");
@@ -94,6 +115,7 @@ void Ieee802154eMac::initialize(int stage) {
         ackLength = par("ackLength");
         ackMessage = nullptr;
         currentAsn = 0;
+        nextSlotAsn = 0;
         currentLink = nullptr;
         currentChannel = 0;
         numPktsArrived = 0;
@@ -129,6 +151,7 @@ void Ieee802154eMac::initialize(int stage) {
         macState = IDLE_1;
         txAttempts = 0;
         statisticTemplate = getProperties()->get("statisticTemplate", "nbStats");
+        recordCellStats = par("recordCellStats").boolValue();
 
     } else if (stage == INITSTAGE_LINK_LAYER) {
         EV_DETAIL << "We are in INISTAGELINK LAYER" << endl;
@@ -165,6 +188,16 @@ void Ieee802154eMac::initialize(int stage) {
         if (!hopping)
             throw cRuntimeError("neighbor module not found");
 
+        lazyRx = par("lazyRx").boolValue();
+        if (lazyRx) {
+            schedule->subscribe(linkAddedSignal, this);
+            schedule->subscribe(linkDeletedSignal, this);
+            schedule->subscribe(linkChangedSignal, this);
+        }
+
+        if (par("profileFsm").boolValue())
+            profiler = new TschMacProfiler(macStateNames, macEventNames);
+
         // Use XML schedule only if SF is disabled
         sf = check_and_cast<TschSF*> (getModuleByPath("^.sixtischInterface.sf"));
         if (sf->par("disable").boolValue()) {
@@ -174,7 +207,7 @@ void Ieee802154eMac::initialize(int stage) {
 
         asn.setMacTsTimeslotLength(macTsTimeslotLength);
         asn.setReference(simTime() + 0.1);
-        scheduleAt(simTime() + 0.1, slotTimer);
+        scheduleAt(asn.getAsnTime(nextSlotAsn), slotTimer);
 
         EV_DETAIL << "QueueLength = " << neighbor->getQueueLength() << " bitrate = " << bitrate << endl;
         EV_DETAIL << "Finished tsch init stage 1." << endl;
@@ -216,6 +249,26 @@ void Ieee802154eMac::finish() {
 //    }
 //    recordScalar("nbBackoffs", nbBackoffs);
 //    recordScalar("backoffDurations", backoffValues);
+
+    if (useMACAcks) {
+        recordScalar("seqNumTxHits", SeqNrParent.getNumHits());
+        recordScalar("seqNumTxMisses", SeqNrParent.getNumMisses());
+        recordScalar("seqNumTxEvictions", SeqNrParent.getNumEvictions());
+        recordScalar("seqNumRxHits", SeqNrChild.getNumHits());
+        recordScalar("seqNumRxMisses", SeqNrChild.getNumMisses());
+        recordScalar("seqNumRxEvictions", SeqNrChild.getNumEvictions());
+        recordScalar("seqNumRxReordered", SeqNrChild.getNumReordered());
+    }
+
+    if (profiler) {
+        std::string filename = par("profileFile").stdstringValue();
+        if (filename.empty()) {
+            auto config = getEnvir()->getConfigEx();
+            filename = std::string(config->getVariable(CFGVAR_RESULTDIR)) + "/" + config->getVariable(CFGVAR_CONFIGNAME)
+                    + "-#" + config->getVariable(CFGVAR_RUNNUMBER) + "-fsmprofile.csv";
+        }
+        profiler->writeTable(filename, getFullPath());
+    }
 }
 
 Ieee802154eMac::~Ieee802154eMac() {
@@ -225,14 +278,44 @@ Ieee802154eMac::~Ieee802154eMac() {
     cancelAndDelete(rxAckTimer);
     cancelAndDelete(slotendTimer);
     cancelAndDelete(hoppingTimer);
+    delete profiler;
     if (ackMessage){
         delete ackMessage;
     }
+    for (auto& entry : ackTemplates)
+        delete entry.second;
     neighbor->clearQueue();
 }
 
 void Ieee802154eMac::emitSignal(signal_names signalName)
 {
+    if (!currentLink)
+        return;
+
+    tschCellStat_t stat = {
+            (tschCellStatType_t) signalName,
+            (offset_t) currentLink->getSlotOffset(),
+            (offset_t) currentLink->getChannelOffset(),
+            currentLink->getAddr().getInt(),
+            currentAsn
+    };
+    sf->handleCellStat(stat);
+
+    if (!recordCellStats)
+        return;
+
+    emit(getCellStatSignal(signalName, SCOPE_CHAN, currentChannel), (int) currentAsn);
+    emit(getCellStatSignal(signalName, SCOPE_LINK, ((uint64_t) stat.slotOffset << 32) | stat.channelOffset), (int) currentAsn);
+    emit(getCellStatSignal(signalName, SCOPE_NEIGH, stat.neighborId), (int) currentAsn);
+}
+
+simsignal_t Ieee802154eMac::getCellStatSignal(signal_names signalName, stat_scopes scope, uint64_t id)
+{
+    auto key = std::make_tuple((int) signalName, (int) scope, id);
+    auto it = cellStatSignals.find(key);
+    if (it != cellStatSignals.end())
+        return it->second;
+
     std::string name;
 
     switch (signalName) {
@@ -258,33 +341,28 @@ void Ieee802154eMac::emitSignal(signal_names signalName)
             name += "nbSlot";
             break;
         default:
-            EV << "EmitSignal Error ! Unknown signal id:" << signalName << endl;
-            return;
+            throw cRuntimeError("Unknown per-cell statistic id: %d", signalName);
     }
 
-    std::vector<std::string> scopes;
-    scopes.push_back(std::string("chan-"));
-    scopes.push_back(std::string("link-"));
-    scopes.push_back(std::string("neigh-"));
-
-    for (auto & scope: scopes) {
-        std::string signalName(scope);
-
-        if (scope == "chan-") signalName += std::to_string(currentChannel);
-        if (scope == "link-") signalName += currentLink->slug();
-        if (scope == "neigh-") signalName += currentLink->getAddr().str();
-
-        signalName = name + "-" + signalName;
-
-        if (std::find(registeredSignals.begin(), registeredSignals.end(), signalName) == registeredSignals.end()) {
-            getEnvir()->addResultRecorders(this, registerSignal(signalName.c_str()), signalName.c_str(), statisticTemplate);
-            registeredSignals.push_back(signalName);
-            par("numSignals").setIntValue(par("numSignals").intValue() + 1); // TODO somewhat hackish, let's see
-        }
-
-        emit(registerSignal(signalName.c_str()), (int) currentAsn);
+    switch (scope) {
+        case SCOPE_CHAN:
+            name += "-chan-" + std::to_string(id);
+            break;
+        case SCOPE_LINK:
+            // same format as TschLink::slug()
+            name += "-link-" + std::to_string(schedule->getMacSlotframeHandle()) + "."
+                    + std::to_string(id >> 32) + "." + std::to_string(id & 0xFFFFFFFF);
+            break;
+        case SCOPE_NEIGH:
+            name += "-neigh-" + MacAddress(id).str();
+            break;
     }
 
+    auto signal = registerSignal(name.c_str());
+    getEnvir()->addResultRecorders(this, signal, name.c_str(), statisticTemplate);
+    cellStatSignals[key] = signal;
+
+    return signal;
 }
 
 
@@ -312,11 +390,62 @@ bool Ieee802154eMac::isUpperMessage(cMessage *message)
 }
 
 bool Ieee802154eMac::isControlPacket(Packet *packet) {
-    std::string packetName(packet->getFullName());
+    return getTrafficClass(packet) & TC_CONTROL;
+}
+
+uint8_t Ieee802154eMac::getTrafficClass(Packet *packet) {
+    auto tag = packet->findTag<TrafficClassTag>();
+    if (tag)
+        return tag->getTrafficClass();
+
+    // IPv6 ND is created by INET, unaware of the tag, but identified by its ICMPv6 type
+    uint8_t trafficClass = isNeighborDiscoveryPacket(packet) ? TC_CONTROL : TC_NONE;
 
-    // FIXME: make a list of control packet names a constant somewhere
-    return packetName.find("NA") != std::string::npos
-            || packetName.find("NS") != std::string::npos;
+    // e.g. RPL packets or packets of applications unaware of the tag, names are only a fallback
+    if (trafficClass == TC_NONE)
+        trafficClass = getTrafficClassFromName(packet->getName());
+
+    packet->addTag<TrafficClassTag>()->setTrafficClass(trafficClass);
+    return trafficClass;
+}
+
+bool Ieee802154eMac::isNeighborDiscoveryPacket(Packet *packet) {
+#ifdef WITH_IPv6
+    auto protocolTag = packet->findTag<PacketProtocolTag>();
+    if (!protocolTag || protocolTag->getProtocol() != &Protocol::ipv6)
+        return false;
+
+    const auto& ipv6Header = packet->peekAtFront<Ipv6Header>();
+    if (ipv6Header->getProtocolId() != IP_PROT_IPv6_ICMP)
+        return false;
+
+    const auto& icmpv6Header = packet->peekDataAt<Icmpv6Header>(ipv6Header->getChunkLength());
+    return icmpv6Header->getType() == ICMPv6_NEIGHBOUR_SOL || icmpv6Header->getType() == ICMPv6_NEIGHBOUR_AD;
+#else
+    return false;
+#endif // ifdef WITH_IPv6
+}
+
+uint8_t Ieee802154eMac::getTrafficClassFromName(const char *packetName) {
+    uint8_t trafficClass = TC_NONE;
+
+    if (strstr(packetName, "NA") || strstr(packetName, "NS"))
+        trafficClass |= TC_CONTROL;
+    if (strstr(packetName, "6top")) {
+        trafficClass |= TC_SIXP;
+        if (strstr(packetName, "Req"))
+            trafficClass |= TC_SIXP_REQUEST;
+    }
+    if (strstr(packetName, "App"))
+        trafficClass |= TC_APP;
+    if (strstr(packetName, "Udp"))
+        trafficClass |= TC_UDP;
+    if (strstr(packetName, "HAZARD"))
+        trafficClass |= TC_HAZARD;
+    if (strstr(packetName, "Bursty"))
+        trafficClass |= TC_BURSTY;
+
+    return trafficClass;
 }
 
 /**
@@ -342,10 +471,12 @@ void Ieee802154eMac::handleUpperPacket(Packet *packet) {
         EV_DETAIL << "virtual link ID set from tag IND = " << linkId << endl;
     }
 
-    if (isControlPacket(packet))
+    auto trafficClass = getTrafficClass(packet);
+    if (trafficClass & TC_CONTROL)
         linkId = LINK_PRIO_CONTROL;
 
     macPkt->setVirtualLinkID(linkId);
+    macPkt->setTrafficClass(trafficClass);
     assert(headerLength % 8 == 0);
     macPkt->setChunkLength(b(headerLength));
     MacAddress dest = packet->getTag<MacAddressReq>()->getDestAddress();
@@ -358,26 +489,10 @@ void Ieee802154eMac::handleUpperPacket(Packet *packet) {
 
     if (useMACAcks)
     {
-        if (SeqNrParent.count(dest) == 0) {
-            //no record of current parent -> add next sequence number to map
-            SeqNrParent[dest][linkId] = 1;
-            macPkt->setSequenceId(0);
-            EV_DETAIL << "Adding a new parent to the sequence numbers map:"
-                     << dest << " with link ID = " << linkId << endl;
-        } else {
-            if (SeqNrParent[dest].count(linkId) == 0) {
-                //no record of current linkId -> add next sequence number to map
-                SeqNrParent[dest][linkId] = 1;
-                macPkt->setSequenceId(0);
-                EV_DETAIL << "Adding a new link to the map of Sequence numbers:"
-                               << linkId << endl;
-            } else {
-                macPkt->setSequenceId(SeqNrParent[dest][linkId]);
-                EV_DETAIL << "Packet sent with sequence number = "
-                                 << SeqNrParent[dest][linkId] << endl;
-                SeqNrParent[dest][linkId]++;
-            }
-        }
+        auto seqNum = SeqNrParent.nextSeqNum(dest, linkId);
+        macPkt->setSequenceId(seqNum);
+        EV_DETAIL << "Packet sent with sequence number = " << seqNum
+                 << " to " << dest << " with link ID = " << linkId << endl;
     }
 
     //RadioAccNoise3PhyControlInfo *pco = new RadioAccNoise3PhyControlInfo(bitrate);
@@ -388,13 +503,19 @@ void Ieee802154eMac::handleUpperPacket(Packet *packet) {
     EV_DETAIL << "Pkt encapsulated, length: " << macPkt->getChunkLength() << endl;
 
     // Notify scheduling function (MSF) to ensure there's a cell available for transmission
-    auto ctrlInfo = new MacGenericInfo(dest.getInt());
-    emit(pktRecFromUpperSignal, 0, (cObject*) ctrlInfo);
+    if (sf)
+        sf->handlePacketEnqueued(dest.getInt());
+    emit(pktRecFromUpperSignal, (long) dest.getInt());
 
     if (neighbor->add2Queue(packet, dest, linkId)) {
         EV_DETAIL << "Added packet to queue with link ID " << linkId << endl;
 
-        if (!isAppPacket(packet))
+        if (lazyRx) {
+            updateLazyRxNeighbor(dest);
+            rescheduleSlotTimer();
+        }
+
+        if (!(trafficClass & TC_APP))
             return;
         else
             numPktsArrived++;
@@ -414,15 +535,11 @@ void Ieee802154eMac::handleUpperPacket(Packet *packet) {
 }
 
 bool Ieee802154eMac::isAppPacket(Packet *packet) {
-    std::string packetName(packet->getFullName());
-
-    return packetName.find("App") != std::string::npos;
+    return getTrafficClass(packet) & TC_APP;
 }
 
 bool Ieee802154eMac::isSmokeAlarmPacket(Packet *packet) {
-    std::string packetName(packet->getFullName());
-
-    return packetName.find("HAZARD") != std::string::npos;
+    return getTrafficClass(packet) & TC_HAZARD;
 }
 
 int Ieee802154eMac::getVirtualLinkId(TschLink* link) {
@@ -455,7 +572,7 @@ double Ieee802154eMac::getQueueUtilization(MacAddress nbrAddr, int virtualLinkId
     return numEnqPackets / (double) neighbor->getQueueLength();
 }
 
-TschLink* Ieee802154eMac::selectActiveLink(std::vector<TschLink*> links) {
+TschLink* Ieee802154eMac::selectActiveLink(const std::vector<TschLink*>& links) {
     if (!links.size())
         return nullptr;
 
@@ -536,20 +653,6 @@ units::values::Hz Ieee802154eMac::getCurrentFrequency() {
     return hopping->channelToCenterFrequency(currentChannel);
 }
 
-bool isControlPacket(std::string packetName) {
-    std::list<std::string> ctrlPktNames = {"NSpacket", "NApacket", "DAO"};
-
-    for (auto name : ctrlPktNames)
-        if (packetName.find(name) != std::string::npos) {
-            EV_DETAIL << packetName << " is a control packet" << endl;
-            return true;
-        }
-
-    EV_DETAIL << packetName << " is NOT a control packet" << endl;
-    return false;
-}
-
-
 int Ieee802154eMac::selectVirtualQueue(MacAddress nbrAddr) {
 //    EV_DETAIL << "Selecting active virtual queue with " << nbrAddr << endl;
 
@@ -636,6 +739,11 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
     switch (event) {
     case EV_TIMER_SLOT: {
         EV_DETAIL << "(1) FSM State IDLE_1, EV_TIMER_SLOT: startTimerSlot -> idle." << endl;
+        if (lazyRx) {
+            creditSkippedSlots(lastSlotAsn, nextSlotAsn);
+            lastSlotAsn = nextSlotAsn;
+        }
+
         // directly schedule next slot
         startTimer(TIMER_SLOT);
 
@@ -650,7 +758,18 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
             return;
 
 
-        currentChannel = hopping->channel(currentAsn, currentLink->getChannelOffset());
+        // channels are resolved per slotframe, links changed since then are looked up on their own
+        updateSlotframeChannels();
+        auto slotOffset = currentLink->getSlotOffset();
+        double currentFrequency = NAN;
+        if (slotOffset < (int) slotframeChannelOffsets.size()
+                && slotframeChannelOffsets[slotOffset] == currentLink->getChannelOffset())
+        {
+            currentChannel = slotframeChannels[slotOffset];
+            currentFrequency = slotframeFrequencies[slotOffset];
+        }
+        else
+            currentChannel = hopping->channel(currentAsn, currentLink->getChannelOffset());
 
 
         if (currentLink->getSlotOffset() == 0)
@@ -684,6 +803,7 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
                 && (sf->par("minCellChannelOffset").intValue() == 39 || hopping->par("disableMinCellHopping").boolValue()))
         {
             currentChannel = hopping->getMinChannel() + sf->par("minCellChannelOffset").intValue();
+            currentFrequency = NAN;
         }
 
 
@@ -701,9 +821,11 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
 //        else
 //            currentChannel = hopping->channel(currentAsn, currentLink->getChannelOffset());
 
-        emit(currentFreqSignal, hopping->channelToCenterFrequencyPlain(currentChannel));
+        if (std::isnan(currentFrequency))
+            currentFrequency = hopping->channelToCenterFrequencyPlain(currentChannel);
+        emit(currentFreqSignal, currentFrequency);
 
-        auto freq = hopping->channelToCenterFrequency(currentChannel);
+        auto freq = Hz(currentFrequency);
 
         EV_DETAIL << currentLink->str() << endl;
 
@@ -770,7 +892,7 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
 
         // Decrement backoff window for all queues directed at link->getAddr
         if(currentLink->isTx() && currentLink->isShared())
-            neighbor->updateAllBackoffWindows(currentLink->getAddr(),schedule);
+            neighbor->countSharedTxCell(currentLink->getAddr());
 
         break;
     }
@@ -782,6 +904,15 @@ void Ieee802154eMac::updateStatusIdle(t_mac_event event, cMessage *msg) {
 
 void Ieee802154eMac::configureRadio(Hz centerFrequency /*= NAN*/,
         int mode /*= -1*/) {
+    // spare the radio a request that wouldn't change anything, e.g. when staying on the same channel
+    bool sameFrequency = std::isnan(centerFrequency.get()) || centerFrequency == configuredFrequency;
+    if (sameFrequency && (mode == -1 || mode == radio->getRadioMode()))
+        return;
+
+    if (!std::isnan(centerFrequency.get()))
+        configuredFrequency = centerFrequency;
+
+    // the radio takes ownership of (and deletes) the request, so it can't be pooled
     auto configureCommand = new ConfigureRadioCommand();
     auto request = new Message("changeChannel", RADIO_C_CONFIGURE);
 
@@ -792,12 +923,176 @@ void Ieee802154eMac::configureRadio(Hz centerFrequency /*= NAN*/,
     sendDown(request);
 }
 
+Packet *Ieee802154eMac::createAck(const MacAddress& dest) {
+    auto& ackTemplate = ackTemplates[dest.getInt()];
+    if (!ackTemplate) {
+        auto csmaHeader = makeShared<Ieee802154eMacHeader>();
+        csmaHeader->setSrcAddr(interfaceEntry->getMacAddress());
+        csmaHeader->setDestAddr(dest);
+        csmaHeader->setChunkLength(b(ackLength));
+        ackTemplate = new Packet("TSCH-Ack");
+        ackTemplate->insertAtFront(csmaHeader);
+        ackTemplate->addTag<PacketProtocolTag>()->setProtocol(&Protocol::ieee802154);
+    }
+
+    // the (immutable) header chunk and the tags are shared with the template, not copied
+    return ackTemplate->dup();
+}
+
 void Ieee802154eMac::flushQueue(MacAddress neighborAddr, int vlinkId) {
     neighbor->flushQueue(neighborAddr, vlinkId); // TODO: access TschNeighbor directly
+    updateLazyRxNeighbor(neighborAddr);
 }
 
 void Ieee802154eMac::flush6pQueue(MacAddress neighborAddr) {
     neighbor->flush6pQueue(neighborAddr); // TODO: access TschNeighbor directly
+    updateLazyRxNeighbor(neighborAddr);
+}
+
+void Ieee802154eMac::updateLazyRxBitmaps() {
+    int size = schedule->getMacSlotframeSize();
+    txEligibleLinks.assign(size, 0);
+    rxOffsets.assign(size, false);
+    lazyRxNeighbors.clear();
+
+    for (auto link : schedule->getLinks()) {
+        auto slotOffset = link->getSlotOffset();
+        if (slotOffset < 0 || slotOffset >= size)
+            continue;
+
+        if (link->isRx())
+            rxOffsets[slotOffset] = true;
+
+        // shared cells are never skipped to keep the CSMA backoff windows going
+        if (link->isTx()) {
+            if (link->isShared())
+                txEligibleLinks[slotOffset]++;
+            else
+                lazyRxNeighbors[link->getAddr().getInt()].txOffsets.push_back(slotOffset);
+        }
+    }
+
+    for (auto& entry : lazyRxNeighbors) {
+        entry.second.queued = neighbor->getTotalQueueSizeAt(MacAddress(entry.first)) > 0;
+        if (entry.second.queued)
+            for (auto slotOffset : entry.second.txOffsets)
+                txEligibleLinks[slotOffset]++;
+    }
+
+    lazyRxDirty = false;
+}
+
+void Ieee802154eMac::updateLazyRxNeighbor(MacAddress neighborAddr) {
+    // a full update is pending anyway
+    if (!lazyRx || lazyRxDirty)
+        return;
+
+    auto it = lazyRxNeighbors.find(neighborAddr.getInt());
+    if (it == lazyRxNeighbors.end())
+        return;
+
+    bool queued = neighbor->getTotalQueueSizeAt(neighborAddr) > 0;
+    if (queued == it->second.queued)
+        return;
+
+    it->second.queued = queued;
+    for (auto slotOffset : it->second.txOffsets)
+        txEligibleLinks[slotOffset] += queued ? 1 : -1;
+}
+
+void Ieee802154eMac::updateSlotframeChannels()
+{
+    int size = schedule->getMacSlotframeSize();
+    auto slotframeAsn = currentAsn - currentAsn % size;
+    if (slotframeAsn == slotframeChannelsAsn && slotframeChannelsRevision == hopping->getTableRevision()
+            && (int) slotframeChannelOffsets.size() == size)
+        return;
+
+    slotframeChannelOffsets.assign(size, -1);
+    for (int offset = 0; offset < size; offset++) {
+        auto &links = schedule->getLinksFromASN(slotframeAsn + offset);
+        if (!links.empty())
+            slotframeChannelOffsets[offset] = links.front()->getChannelOffset();
+    }
+
+    slotframeChannels = hopping->channelsForSlotframe(slotframeAsn, slotframeChannelOffsets, &slotframeFrequencies);
+    slotframeChannelsAsn = slotframeAsn;
+    slotframeChannelsRevision = hopping->getTableRevision();
+}
+
+int64_t Ieee802154eMac::getNextAwakeAsn(int64_t fromAsn) {
+    if (lazyRxDirty)
+        updateLazyRxBitmaps();
+
+    auto size = schedule->getMacSlotframeSize();
+    auto first = schedule->getASNofNextLink(fromAsn);
+
+    for (auto next = first; next > 0 && next - first < size; next = schedule->getASNofNextLink(next)) {
+        auto slotOffset = next % size;
+        // slot offset 0 is never skipped to keep the per-slotframe statistics
+        if (slotOffset == 0 || txEligibleLinks[slotOffset] > 0 || rxOffsets[slotOffset])
+            return next;
+    }
+
+    // nothing worth waking up for, keep the regular pace
+    return first;
+}
+
+void Ieee802154eMac::creditSkippedSlots(int64_t fromAsn, int64_t toAsn) {
+    if (fromAsn < 0 || toAsn - fromAsn <= 1)
+        return;
+
+    int size = schedule->getMacSlotframeSize();
+
+    // whole slotframes skipped at once: dedicated TX cells of one slotframe, straight
+    // from the schedule, credited once per skipped slotframe
+    auto numSlotframes = (toAsn - fromAsn - 1) / size;
+    if (numSlotframes > 0) {
+        std::map<uint64_t, int> cellsPerSlotframe;
+        for (auto next = schedule->getASNofNextLink(fromAsn);
+                next > 0 && next <= fromAsn + size; next = schedule->getASNofNextLink(next))
+        {
+            for (auto link : schedule->getLinksFromASN(next))
+                if (isDedicatedTxLink(link))
+                    cellsPerSlotframe[link->getAddr().getInt()]++;
+        }
+
+        for (auto const& entry : cellsPerSlotframe)
+            sf->incrementNeighborCellsElapsed(entry.first, (int) (entry.second * numSlotframes));
+    }
+
+    // the rest of the last slotframe
+    for (auto next = schedule->getASNofNextLink(fromAsn + numSlotframes * size);
+            next > 0 && next < toAsn; next = schedule->getASNofNextLink(next))
+    {
+        for (auto link : schedule->getLinksFromASN(next))
+            if (isDedicatedTxLink(link))
+                sf->incrementNeighborCellsElapsed(link->getAddr().getInt(), 1);
+    }
+}
+
+simtime_t Ieee802154eMac::getNextSlotframeStart(int slotframeLength) {
+    if (simTime() < asn.getReference())
+        return asn.getReference();
+
+    // not currentAsn, which may be stale if we've been sleeping (lazy RX)
+    auto nowAsn = asn.getAsn(simTime());
+    return asn.getAsnTime((nowAsn / slotframeLength + 1) * slotframeLength);
+}
+
+void Ieee802154eMac::rescheduleSlotTimer() {
+    if (!lazyRx || lastSlotAsn < 0 || !slotTimer->isScheduled())
+        return;
+
+    auto next = getNextAwakeAsn(lastSlotAsn);
+    auto at = asn.getAsnTime(next);
+
+    if (at >= simTime() && at < slotTimer->getArrivalTime()) {
+        EV_DEBUG << "(lazy RX) moving slotTimer forward to ASN #" << next << endl;
+        cancelEvent(slotTimer);
+        nextSlotAsn = next;
+        scheduleAt(at, slotTimer);
+    }
 }
 
 void Ieee802154eMac::attachSignal(Packet *mac, simtime_t_cref startTime) {
@@ -870,6 +1165,7 @@ void Ieee802154eMac::updateStatusTransmitFrame(t_mac_event event, cMessage *msg)
         EV_DETAIL << ": RadioSetupSleep..." << endl;
         radio->setRadioMode(IRadio::RADIO_MODE_SLEEP);
         neighbor->removeFirstPacketFromQueue();
+        updateLazyRxNeighbor(csmaHeader->getDestAddr());
         delete packet;
         updateMacState(IDLE_1);
     }
@@ -886,6 +1182,7 @@ void Ieee802154eMac::updateStatusWaitAck(t_mac_event event, cMessage *msg) {
             cancelEvent(rxAckTimer);
         cMessage *mac = neighbor->getCurrentNeighborQueueFirstPacket();
         neighbor->removeFirstPacketFromQueue();
+        updateLazyRxNeighbor(check_and_cast<Packet *>(mac)->peekAtFront<Ieee802154eMacHeader>()->getDestAddr());
 
         auto numBurstyPackets = neighbor->getNumBurstyPktsInQueue();
 
@@ -1004,6 +1301,7 @@ void Ieee802154eMac::manageFailedTX(bool recordStats) {
                 << " times and an ACK was never received. The packet is dropped." << endl;
         cMessage *mac = neighbor->getCurrentNeighborQueueFirstPacket();
         neighbor->removeFirstPacketFromQueue();
+        updateLazyRxNeighbor(check_and_cast<Packet *>(mac)->peekAtFront<Ieee802154eMacHeader>()->getDestAddr());
         neighbor->terminateCurrentTschCSMA();
         PacketDropDetails details;
         details.setReason(RETRY_LIMIT_REACHED);
@@ -1153,9 +1451,21 @@ void Ieee802154eMac::updateStatusTransmitAck(t_mac_event event, cMessage *msg) {
 }
 
 /**
- * Updates state machine.
+ * Updates state machine, measuring each transition if FSM profiling is enabled.
  */
 void Ieee802154eMac::executeMac(t_mac_event event, cMessage *msg) {
+    if (!profiler) {
+        updateStatus(event, msg);
+        return;
+    }
+
+    auto state = macState;
+    auto start = TschMacProfiler::now();
+    updateStatus(event, msg);
+    profiler->record(state, event, start);
+}
+
+void Ieee802154eMac::updateStatus(t_mac_event event, cMessage *msg) {
     switch (macState) {
     case IDLE_1:
         updateStatusIdle(event, msg);
@@ -1212,12 +1522,14 @@ void Ieee802154eMac::fsmError(t_mac_event event, cMessage *msg) {
 
 void Ieee802154eMac::startTimer(t_mac_timer timer) {
     if (timer == TIMER_SLOT) {
-        currentAsn = asn.getAsn(simTime());
-        auto next = schedule->getASNofNextLink(currentAsn);
-        auto at = (next - currentAsn) * macTsTimeslotLength;
-
-        EV_DEBUG << "(startTimer) slotTimer value=" << at << endl;
-        scheduleAt(simTime() + at, slotTimer);
+        // the slot timer only fires at the slot it was scheduled for
+        currentAsn = nextSlotAsn;
+        ASSERT(currentAsn == asn.getAsn(simTime()));
+        nextSlotAsn = lazyRx ? getNextAwakeAsn(currentAsn) : schedule->getASNofNextLink(currentAsn);
+        auto at = asn.getAsnTime(nextSlotAsn);
+
+        EV_DEBUG << "(startTimer) slotTimer value=" << at - simTime() << endl;
+        scheduleAt(at, slotTimer);
     } else if (timer == TIMER_CCA) {
         simtime_t ccaTime = rxSetupTime + ccaDetectionTime;
         EV_DEBUG << "(startTimer) ccaTimer value=" << ccaTime
@@ -1290,9 +1602,9 @@ void Ieee802154eMac::handleSelfMessage(cMessage *msg) {
 }
 
 bool Ieee802154eMac::artificiallyDropAppPacket(Packet *packet) {
-    std::string packetName(packet->getFullName());
+    const auto& header = packet->peekAtFront<Ieee802154eMacHeader>();
 
-    if (packetName.find(std::string("Udp")) != std::string::npos) {
+    if (header->getTrafficClass() & TC_UDP) {
 
         auto r = uniform(0, 1, 2);
         bool drop = r < pLinkCollision;
@@ -1365,7 +1677,6 @@ void Ieee802154eMac::handleLowerPacket(Packet *packet) {
     const auto& csmaHeader = packet->peekAtFront<Ieee802154eMacHeader>();
     const MacAddress& src = csmaHeader->getSrcAddr();
     const MacAddress& dest = csmaHeader->getDestAddr();
-    long ExpectedNr = 0;
     MacAddress address = interfaceEntry->getMacAddress();
     EV_DETAIL << "Received frame name= " << csmaHeader->getName()
                      << ", myState=" << macState << " src=" << src << " dst="
@@ -1400,47 +1711,19 @@ void Ieee802154eMac::handleLowerPacket(Packet *packet) {
                 EV << "Number of received frames: " << nbRxFrames << endl;
                 if (ackMessage != nullptr)
                     delete ackMessage;
-                auto csmaHeader = makeShared<Ieee802154eMacHeader>();
-                csmaHeader->setSrcAddr(address);
-                csmaHeader->setDestAddr(src);
-                csmaHeader->setChunkLength(b(ackLength));
-                ackMessage = new Packet("TSCH-Ack");
-                ackMessage->insertAtFront(csmaHeader);
-                ackMessage->addTag<PacketProtocolTag>()->setProtocol(
-                        &Protocol::ieee802154);
+                ackMessage = createAck(src);
                 //Check for duplicates by checking expected seqNr of sender
-                if (SeqNrChild.count(src) == 0) {
-                    //no record of current child -> add expected next number to map
-                    SeqNrChild[src][linkId] = SeqNr + 1;
-                    EV_DETAIL
-                                     << "Adding a new child to the map of Sequence numbers:"
-                                     << src << " with linkId " << linkId << endl;
+                EV_DETAIL << "Received sequence number " << SeqNr << " from " << src
+                                 << " with linkid " << linkId << endl;
+                if (SeqNrChild.receive(src, linkId, SeqNr))
                     executeMac(EV_FRAME_RECEIVED, packet);
-                } else {
-                    if (SeqNrChild[src].count(linkId) == 0) {
-                        //no record of current linkId -> add expected next number to map
-                        SeqNrChild[src][linkId] = SeqNr + 1;
-                        EV_DETAIL
-                                         << "Adding a new linkId to the map of Sequence numbers:"
-                                         << linkId << endl;
-                        executeMac(EV_FRAME_RECEIVED, packet);
-                    } else {
-                        ExpectedNr = SeqNrChild[src][linkId];
-                        EV_DETAIL << "Expected Sequence number is " << ExpectedNr
-                                         << " and number of packet is " << SeqNr
-                                         << " with linkid " << linkId << endl;
-                        if (SeqNr < ExpectedNr) {
-                            //Duplicate Packet, count and do not send to upper layer
-                            nbDuplicates++;
-
-                            emitSignal(NBDUPLICATES);
-
-                            executeMac(EV_DUPLICATE_RECEIVED, packet);
-                        } else {
-                            SeqNrChild[src][linkId] = SeqNr + 1;
-                            executeMac(EV_FRAME_RECEIVED, packet);
-                        }
-                    }
+                else {
+                    //Duplicate Packet, count and do not send to upper layer
+                    nbDuplicates++;
+
+                    emitSignal(NBDUPLICATES);
+
+                    executeMac(EV_DUPLICATE_RECEIVED, packet);
                 }
             }
             else if (neighbor->getCurrentNeighborQueueSize() != 0) {
@@ -1490,6 +1773,18 @@ void Ieee802154eMac::receiveSignal(cComponent *source, simsignal_t signalID,
     }
 }
 
+void Ieee802154eMac::receiveSignal(cComponent *source, simsignal_t signalID,
+        cObject *obj, cObject *details) {
+    Enter_Method_Silent();
+    if (signalID == linkAddedSignal || signalID == linkDeletedSignal || signalID == linkChangedSignal) {
+        lazyRxDirty = true;
+        rescheduleSlotTimer();
+        return;
+    }
+
+    MacProtocolBase::receiveSignal(source, signalID, obj, details);
+}
+
 void Ieee802154eMac::decapsulate(Packet *packet) {
     const auto& tschHeader = packet->popAtFront<Ieee802154eMacHeader>();
     packet->addTagIfAbsent<MacAddressInd>()->setSrcAddress(
@@ -1502,6 +1797,7 @@ void Ieee802154eMac::decapsulate(Packet *packet) {
     packet->addTagIfAbsent<PacketProtocolTag>()->setProtocol(payloadProtocol);
     packet->addTagIfAbsent<VirtualLinkTagInd>()->setVirtualLinkID(
             tschHeader->getVirtualLinkID());
+    packet->addTagIfAbsent<TrafficClassTag>()->setTrafficClass(tschHeader->getTrafficClass());
 
 }
 
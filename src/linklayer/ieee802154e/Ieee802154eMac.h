@@ -43,8 +43,11 @@
 #include "Ieee802154eASN.h"
 #include "TschHopping.h"
 #include "TschNeighbor.h"
+#include "TschMacProfiler.h"
+#include "TschSeqNumTable.h"
 #include "sixtisch/TschSF.h"
 #include "inet/common/Units.h"
+#include <unordered_map>
 #include <vector>
 #include <tuple>
 #include "sixtisch/Tsch6tischComponents.h"
@@ -63,19 +66,6 @@ namespace tsch {
 class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
 {
   public:
-
-    class MacGenericInfo : public cObject {
-        private:
-            uint64_t nodeId;
-
-        public:
-            MacGenericInfo() {}
-            MacGenericInfo(uint64_t nodeId) { this->nodeId = nodeId; }
-
-            uint64_t getNodeId() { return this->nodeId; }
-            void setNodeId(uint64_t nodeId) { this->nodeId = nodeId; }
-    };
-
     Ieee802154eMac()
         : MacProtocolBase()
         , nbTxFrames(0)
@@ -116,11 +106,16 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
         , pLinkCollision(-1)
         , ackLength(0)
         , ackMessage(nullptr)
-        , SeqNrParent()
-        , SeqNrChild()
+        , configuredFrequency(NAN)
         , wrr_be_ctn(0)
         , wrr_np_ctn(0)
         , lastAppPktArrivalTimestamp(0)
+        , lazyRx(false)
+        , lazyRxDirty(true)
+        , lastSlotAsn(-1)
+        , slotframeChannelsAsn(-1)
+        , slotframeChannelsRevision(0)
+        , profiler(nullptr)
     {
     }
 
@@ -156,6 +151,9 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
     /** @brief Handle control messages from lower layer */
     virtual void receiveSignal(cComponent *source, inet::simsignal_t signalID, long value, cObject *details) override;
 
+    /** @brief Handle schedule changes (lazy RX) */
+    virtual void receiveSignal(cComponent *source, inet::simsignal_t signalID, cObject *obj, cObject *details) override;
+
     virtual inet::physicallayer::IRadio* getRadio();
 
     void sendUp(cMessage *message) override;
@@ -209,6 +207,12 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
         neighbor->terminateTschCsmaWith(nbrAddr);
     }
 
+    /**
+     * Start time of the next slotframe of @p slotframeLength timeslots,
+     * i.e. of the next slot whose ASN is a multiple of @p slotframeLength
+     */
+    simtime_t getNextSlotframeStart(int slotframeLength);
+
   protected:
     /** @name Different tracked statistics.*/
     /*@{*/
@@ -330,14 +334,22 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
         EXPONENTIAL,
     };
 
+    /** @brief Per-cell statistics, reported to the SF as tschCellStat_t */
     enum signal_names {
-        NBTXFRAMES = 0,
-        NBMISSEDACKS,
-        NBRECVDACKS,
-        NBRXFRAMES,
-        NBTXACKS,
-        NBDUPLICATES,
-        NBSLOT
+        NBTXFRAMES = CELLSTAT_TXFRAMES,
+        NBMISSEDACKS = CELLSTAT_MISSEDACKS,
+        NBRECVDACKS = CELLSTAT_RECVDACKS,
+        NBRXFRAMES = CELLSTAT_RXFRAMES,
+        NBTXACKS = CELLSTAT_TXACKS,
+        NBDUPLICATES = CELLSTAT_DUPLICATES,
+        NBSLOT = CELLSTAT_SLOT
+    };
+
+    /** @brief Scopes of the optional per-cell statistics result recording */
+    enum stat_scopes {
+        SCOPE_CHAN = 0,
+        SCOPE_LINK,
+        SCOPE_NEIGH
     };
 
     /** @brief keep track of MAC state */
@@ -442,14 +454,50 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
     double lastAppPktArrivalTimestamp; // helper variable for the "pktInterarrivalTime" stat
     simsignal_t currentFreqSignal; // ping current frequency to RPL
 
-    std::vector<std::string> registeredSignals;
+    /** @brief Record the per-cell statistics as "<stat>-<scope>-<id>" results */
+    bool recordCellStats;
+
+    /** @brief Lazily registered result signals, keyed by (statistic, scope, id) */
+    std::map<std::tuple<int, int, uint64_t>, simsignal_t> cellStatSignals;
 
     TschNeighbor *neighbor;
     TschSlotframe *schedule;
     Ieee802154eASN asn;
     TschSF *sf;
 
+    /** @brief Lazy RX mode, see lazyRx NED parameter */
+    bool lazyRx;
+    /** @brief Schedule changed since the bitmaps below have been computed, queue changes are applied right away */
+    bool lazyRxDirty;
+    /** @brief Per slot offset: number of TX links with packets queued (or shared ones) */
+    std::vector<int> txEligibleLinks;
+    /** @brief Per slot offset: there's an RX link */
+    std::vector<bool> rxOffsets;
+    /** @brief Slot offsets of the dedicated TX links to a neighbor, counted in txEligibleLinks if queued */
+    struct LazyRxNeighbor {
+        std::vector<int> txOffsets;
+        bool queued = false;
+    };
+    std::unordered_map<uint64_t, LazyRxNeighbor> lazyRxNeighbors;
+    /** @brief ASN of the last slot we woke up in */
+    int64_t lastSlotAsn;
+
+    /** @brief ASN of slot offset 0 of the slotframe the channels below have been resolved for */
+    int64_t slotframeChannelsAsn;
+    /** @brief Hopping table revision the channels below have been resolved with */
+    unsigned int slotframeChannelsRevision;
+    /** @brief Per slot offset: channel offset of the first link scheduled, -1 if none */
+    TschHopping::PatternVector slotframeChannelOffsets;
+    /** @brief Per slot offset: channel and center frequency for the channel offset above */
+    TschHopping::PatternVector slotframeChannels;
+    std::vector<double> slotframeFrequencies;
+
+    /** @brief FSM profiling, nullptr unless the profileFsm parameter is set */
+    TschMacProfiler *profiler;
+
     int64_t currentAsn;
+    /** @brief ASN the slot timer is scheduled for, becomes currentAsn when it fires */
+    int64_t nextSlotAsn;
     TschLink *currentLink;
     int currentChannel;
 
@@ -490,8 +538,38 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
     virtual void configureInterfaceEntry() override;
     virtual void handleCommand(omnetpp::cMessage *msg) {}
 
+    /**
+     * @brief Report per-cell statistic @p signalName for the current link
+     *        to the SF and record it, if enabled
+     */
     virtual void emitSignal(signal_names signalName);
 
+    /** @brief Returns the result signal for the given statistic and scope, registering it on first use */
+    simsignal_t getCellStatSignal(signal_names signalName, stat_scopes scope, uint64_t id);
+
+    /** @brief Lazy RX: recompute the TX-eligible and RX slot offset bitmaps */
+    void updateLazyRxBitmaps();
+
+    /** @brief Lazy RX: update the TX-eligible slot offsets of a neighbor whose queue changed */
+    void updateLazyRxNeighbor(MacAddress neighborAddr);
+
+    /** @brief Lazy RX: ASN of the next slot after @p fromAsn worth waking up for */
+    int64_t getNextAwakeAsn(int64_t fromAsn);
+
+    /** @brief Lazy RX: account for the dedicated TX cells elapsed in-between two wake ups */
+    void creditSkippedSlots(int64_t fromAsn, int64_t toAsn);
+
+    /** @brief Resolve the channels of the current slotframe at once when entering it */
+    void updateSlotframeChannels();
+
+    /** @brief Lazy RX: move the slot timer forward if a skipped slot became relevant */
+    void rescheduleSlotTimer();
+
+    /** @brief Lazy RX: whether @p link is a dedicated TX cell accounted for by the SF */
+    bool isDedicatedTxLink(TschLink *link) const {
+        return link->isTx() && !link->isShared() && !link->getAddr().isBroadcast();
+    }
+
     /** @brief Asynchronously configure carrier frequency and mode of radio
      *
      * When a default value is given for one of the parameters,
@@ -505,6 +583,7 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
     // FSM functions
     void fsmError(t_mac_event event, omnetpp::cMessage *msg);
     void executeMac(t_mac_event event, omnetpp::cMessage *msg);
+    void updateStatus(t_mac_event event, omnetpp::cMessage *msg);
     void updateStatusIdle(t_mac_event event, omnetpp::cMessage *msg);
     void updateStatusHopping(t_mac_event event, omnetpp::cMessage *msg);
     void updateStatusCCA(t_mac_event event, omnetpp::cMessage *msg);
@@ -539,29 +618,45 @@ class Ieee802154eMac : public inet::MacProtocolBase, public inet::IMacProtocol
      *  @param links list of all links scheduled with neigbhors
      *  @return link selected to be active for current ASN
      */
-    TschLink* selectActiveLink(std::vector<TschLink*> links);
+    TschLink* selectActiveLink(const std::vector<TschLink*>& links);
 
     virtual void decapsulate(inet::Packet *packet);
 
     inet::Packet *ackMessage;
 
-    //sequence number for sending, map for the general case with more senders
+    /** @brief ACK frame per destination (MAC address as integer), only duplicated, never sent */
+    std::unordered_map<uint64_t, inet::Packet *> ackTemplates;
+
+    /** @brief Returns a new ACK frame to @p dest, a duplicate of its template sharing the header */
+    inet::Packet *createAck(const inet::MacAddress& dest);
+
+    /** @brief Center frequency last requested from the radio */
+    Hz configuredFrequency;
+
+    //sequence number for sending, per (neighbor, virtual link) for the general case with more senders
     //also in initialisation phase multiple potential parents
-    std::map<inet::MacAddress, std::map<int, unsigned long>> SeqNrParent;    //parent -> sequence number
+    TschSeqNumTable SeqNrParent;    //parent -> sequence number
 
-    //sequence numbers for receiving
-    std::map<inet::MacAddress, std::map<int, unsigned long>> SeqNrChild;    //child -> sequence number
+    //sequence numbers for receiving, to detect duplicates
+    TschSeqNumTable SeqNrChild;    //child -> sequence number
 
     bool artificiallyDropAppPacket(Packet *packet);
     bool drop6pPacket(Packet *packet, std::string cmdType, std::string pktType);
 
 
     /**
-     * Determine whether a packet belongs to IPv6, IPv6 Neighbor Discovery or RPL control packets based on its name
-     *
-     * @param packetName name of the packet to check its affiliation
+     * Traffic class (TrafficClass bit mask) of @p packet, as tagged by the application
+     * or 6P layer. Untagged packets of foreign modules are classified once, IPv6 neighbor
+     * discovery by its ICMPv6 type and anything else from its name, and tagged accordingly.
      */
-    bool isControlPacket(std::string packetName);
+    uint8_t getTrafficClass(Packet *packet);
+
+    /** Whether @p packet is an IPv6 neighbor solicitation or advertisement */
+    static bool isNeighborDiscoveryPacket(Packet *packet);
+
+    /** Derive the TrafficClass bit mask from the name of a packet not tagged by its originating layer */
+    static uint8_t getTrafficClassFromName(const char *packetName);
+
     bool isAppPacket(Packet *packet);
     bool isSmokeAlarmPacket(Packet *packet);
 
@@ -0,0 +1,129 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "TschBinaryParser.h"
+
+namespace inet{
+
+std::map<std::string, TschBinaryParser::CachedFile> TschBinaryParser::files;
+
+TschBinaryParser::FileBuffer TschBinaryParser::getFile(const char *filename)
+{
+    // a batch of runs may regenerate the file in between, so only reuse
+    // the cached content while the file on disk is unchanged
+    struct stat st;
+    if (stat(filename, &st) != 0)
+        throw cRuntimeError("Error opening compiled schedule file `%s'", filename);
+
+    auto it = files.find(filename);
+    if (it != files.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size)
+        return it->second.buffer;
+
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in)
+        throw cRuntimeError("Error opening compiled schedule file `%s'", filename);
+
+    auto buffer = std::make_shared<std::vector<char>>(in.tellg());
+    in.seekg(0);
+    in.read(buffer->data(), buffer->size());
+    if (!in)
+        throw cRuntimeError("Error reading compiled schedule file `%s'", filename);
+
+    Header header;
+    if (buffer->size() < sizeof(header))
+        throw cRuntimeError("Compiled schedule file `%s' is truncated", filename);
+    memcpy(&header, buffer->data(), sizeof(header));
+
+    if (strncmp(header.magic, "TSCB", 4) != 0)
+        throw cRuntimeError("`%s' is not a compiled schedule file", filename);
+    if (header.version != VERSION)
+        throw cRuntimeError("Unsupported version %u of compiled schedule file `%s', expected %u",
+                header.version, filename, VERSION);
+
+    auto expectedSize = sizeof(Header) + header.numSchedules * sizeof(ScheduleRecord)
+            + header.numSlotframes * sizeof(SlotframeRecord) + header.numLinks * sizeof(LinkRecord);
+    if (buffer->size() != expectedSize)
+        throw cRuntimeError("Compiled schedule file `%s' has %lu bytes, expected %lu", filename,
+                (unsigned long) buffer->size(), (unsigned long) expectedSize);
+
+    files[filename] = { buffer, st.st_mtime, st.st_size };
+    return buffer;
+}
+
+int TschBinaryParser::readSchedule(const char *filename, int index, const TschParser::SlotframeHandler& onSlotframe,
+        const TschParser::LinkHandler& onLink)
+{
+    auto file = getFile(filename);
+    const char *data = file->data();
+
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (index < 0 || index >= (int) header.numSchedules)
+        throw cRuntimeError("Schedule index %d out of range, compiled schedule file `%s' holds %u schedules",
+                index, filename, header.numSchedules);
+
+    const char *schedules = data + sizeof(Header);
+    const char *slotframes = schedules + header.numSchedules * sizeof(ScheduleRecord);
+    const char *links = slotframes + header.numSlotframes * sizeof(SlotframeRecord);
+
+    ScheduleRecord schedule;
+    memcpy(&schedule, schedules + index * sizeof(ScheduleRecord), sizeof(schedule));
+    if (schedule.firstSlotframe + schedule.numSlotframes > header.numSlotframes)
+        throw cRuntimeError("Corrupt schedule %d in compiled schedule file `%s'", index, filename);
+
+    TschParser::Tsch_Link link;
+    link.Neighbor_path = "";
+
+    for (uint32_t i = schedule.firstSlotframe; i < schedule.firstSlotframe + schedule.numSlotframes; i++) {
+        SlotframeRecord sf;
+        memcpy(&sf, slotframes + i * sizeof(SlotframeRecord), sizeof(sf));
+        if (sf.firstLink + sf.numLinks > header.numLinks)
+            throw cRuntimeError("Corrupt slotframe %u in compiled schedule file `%s'", i, filename);
+
+        onSlotframe(sf.handle, sf.macSlotframeSize);
+
+        for (uint32_t j = sf.firstLink; j < sf.firstLink + sf.numLinks; j++) {
+            LinkRecord rec;
+            memcpy(&rec, links + j * sizeof(LinkRecord), sizeof(rec));
+
+            link.SlotOffset = rec.slotOffset;
+            link.channelOffset = rec.channelOffset;
+            link.Option_tx = rec.options & OPT_TX;
+            link.Option_rx = rec.options & OPT_RX;
+            link.Option_shared = rec.options & OPT_SHARED;
+            link.Option_timekeeping = rec.options & OPT_TIMEKEEPING;
+            link.Type_normal = rec.options & OPT_NORMAL;
+            link.Type_advertising = rec.options & OPT_ADVERTISING;
+            link.Type_advertisingOnly = rec.options & OPT_ADVERTISINGONLY;
+            link.Virtual_id = rec.virtualId;
+            link.Neighbor_address = MacAddress(rec.neighbor);
+            onLink(link);
+        }
+    }
+
+    return schedule.numSlotframes;
+}
+
+} // namespace inet
@@ -0,0 +1,119 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INET_TschBinaryParser_H
+#define __INET_TschBinaryParser_H
+
+#include <map>
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
+#include "TschParser.h"
+
+namespace inet{
+
+/*
+ * Reads compiled (binary) Tsch_Schedule files, as written by
+ * schedulegenerator/schedule_compiler.py. One file holds the schedules of
+ * many nodes, each node picks its own by index. All values are little-endian.
+ *
+ *   header     {char magic[4] = "TSCB"; uint32 version; uint32 numSchedules;
+ *               uint32 numSlotframes; uint32 numLinks}
+ *   schedules  numSchedules  x {uint32 firstSlotframe; uint32 numSlotframes}
+ *   slotframes numSlotframes x {int32 handle; int32 macSlotframeSize;
+ *                               uint32 firstLink; uint32 numLinks}
+ *   links      numLinks      x {uint16 slotOffset; uint16 channelOffset;
+ *                               uint16 options; int16 virtualId; uint64 neighbor}
+ *
+ * The file is read once per process and shared by all nodes referring to it.
+ */
+class TschBinaryParser
+{
+  public:
+    static const uint32_t VERSION = 1;
+
+    enum LinkOptions {
+        OPT_TX              = 1 << 0,
+        OPT_RX              = 1 << 1,
+        OPT_SHARED          = 1 << 2,
+        OPT_TIMEKEEPING     = 1 << 3,
+        OPT_NORMAL          = 1 << 4,
+        OPT_ADVERTISING     = 1 << 5,
+        OPT_ADVERTISINGONLY = 1 << 6
+    };
+
+    /**
+     * Read schedule number @p index from compiled schedule file @p filename
+     * and pass its slotframes and links to @p onSlotframe and @p onLink.
+     *
+     * @return number of slotframes read
+     */
+    int readSchedule(const char *filename, int index, const TschParser::SlotframeHandler& onSlotframe,
+            const TschParser::LinkHandler& onLink);
+
+  protected:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t numSchedules;
+        uint32_t numSlotframes;
+        uint32_t numLinks;
+    };
+
+    struct ScheduleRecord {
+        uint32_t firstSlotframe;
+        uint32_t numSlotframes;
+    };
+
+    struct SlotframeRecord {
+        int32_t handle;
+        int32_t macSlotframeSize;
+        uint32_t firstLink;
+        uint32_t numLinks;
+    };
+
+    struct LinkRecord {
+        uint16_t slotOffset;
+        uint16_t channelOffset;
+        uint16_t options;
+        int16_t virtualId;
+        uint64_t neighbor;
+    };
+
+    typedef std::shared_ptr<const std::vector<char>> FileBuffer;
+
+    // Content of @p filename, read and validated on first use and again
+    // whenever the file's modification time or size changed since
+    static FileBuffer getFile(const char *filename);
+
+  private:
+    struct CachedFile {
+        FileBuffer buffer;
+        time_t mtime;
+        off_t size;
+    };
+
+    static std::map<std::string, CachedFile> files;
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_TschBinaryParser_H
@@ -28,7 +28,9 @@ namespace tsch{
 TschCSMA::TschCSMA(){
     this->NB = 0;
     this->BE = 0;
-    this->randomNumber = 0;
+    this->backoffEnd = 0;
+    this->ownEpoch = 0;
+    this->sharedEpoch = nullptr;
     this->hasStarted = false;
     rng = nullptr;
 }
@@ -36,7 +38,9 @@ TschCSMA::TschCSMA(){
 TschCSMA::TschCSMA(int minBE, int maxBE, cRNG* rng){
     this->NB = 0;
     this->BE = 0;
-    this->randomNumber = 0;
+    this->backoffEnd = 0;
+    this->ownEpoch = 0;
+    this->sharedEpoch = nullptr;
     this->macMinBE = minBE;
     this->macMaxBE = maxBE;
     this->hasStarted = false;
@@ -56,22 +60,21 @@ void TschCSMA::startTschCSMA(){
 
 int TschCSMA::generateRandomNumber(){
     // 1<<n is the same as 2^n
-    this->randomNumber = intuniform(rng, 0, (1<<this->BE)-1);
-    return this->randomNumber;
+    int randomNumber = intuniform(rng, 0, (1<<this->BE)-1);
+    this->backoffEnd = currentEpoch() + randomNumber;
+    return randomNumber;
 }
 
-bool TschCSMA::checkBackoff(){
-    if(this->randomNumber == 0 || !this->hasStarted){
-        return true;
-    }else{
-        return false;
-    }
+void TschCSMA::setEpoch(const long *epoch){
+    int remaining = getRandomNumber();
+    this->sharedEpoch = epoch;
+    this->backoffEnd = currentEpoch() + remaining;
 }
 
 void TschCSMA::terminate(){
     this->BE = 0;
     this->NB = 0;
-    this->randomNumber = 0;
+    this->backoffEnd = currentEpoch();
     this->hasStarted = false;
 }
 void TschCSMA::failedTX(bool isDedicated){
@@ -102,7 +105,7 @@ void TschCSMA::failedTX(bool isDedicated){
         EV_DETAIL << "TschCSMA has already started" << endl;
         EV_DETAIL << "NB incremented by 1: NB= " << this->NB<< endl;
         EV_DETAIL << "A new value has been selected for BE: BE= " << this->BE<< endl;
-        EV_DETAIL << "A new value has been generated for the delay: Delay= " << this->randomNumber << endl;
+        EV_DETAIL << "A new value has been generated for the delay: Delay= " << this->getRandomNumber() << endl;
         EV_DETAIL << "Returning to Idle state" << endl;
     }
 }
@@ -142,7 +145,7 @@ int TschCSMA::getMacMaxBE() {
     return this->macMaxBE;
 }
 int TschCSMA::getRandomNumber() {
-    return this->randomNumber;
+    return (int) std::max(this->backoffEnd - currentEpoch(), 0L);
 }
 
 bool TschCSMA::getTschCSMAStatus(){
@@ -160,7 +163,7 @@ std::string TschCSMA::str() {
         out << " started ";
     out << " NB " << NB;
     out << " BE " << BE;
-    out << " RND " << randomNumber;
+    out << " RND " << getRandomNumber();
     out << " minBE " << macMinBE;
     out << " maxBE " << macMaxBE;
 
@@ -168,9 +171,9 @@ std::string TschCSMA::str() {
 }
 
 void TschCSMA::decrementRandomNumber(){
-    if(this->getTschCSMAStatus()) {
+    if(this->getTschCSMAStatus() && this->getRandomNumber() > 0) {
         EV_DETAIL << "[ TschCSMA ] Reducing backoff window" << endl;
-        this->randomNumber = this->randomNumber - 1;
+        this->backoffEnd--;
     }
 }
 }
@@ -88,8 +88,8 @@ public:
      */
     int getMacMaxBE();
     /**
-     * A public member function to get the private randomNumber variable.
-     * @return randomNumber variable
+     * A public member function to get the current backoff state.
+     * @return number of shared cells left until the backoff is over
      */
     int getRandomNumber();
     /**
@@ -106,11 +106,9 @@ public:
     void startTschCSMA();
     /**
      * A public member function to check if the CSMA is still in the backoff and returns the state.
-     * If the randomNumber is 0 the function return true
-     * If the randomNumber is not 0 it will reduce the randomnumber by 1 and return false
-     * @return state of the backoff
+     * @return true if the backoff is over (or the CSMA hasn't started), i.e. the epoch reached backoffEnd
      */
-    bool checkBackoff();
+    bool checkBackoff() { return !hasStarted || currentEpoch() >= backoffEnd; }
     /**
      * A public member function taking one int argument which represents the maximumg backoff exponent increases the NB and BE.
      * NB is increased by 1 and the BE takes the minimum of either an incremented BE or the argument
@@ -140,6 +138,15 @@ public:
      *
      */
     void decrementRandomNumber();
+    /**
+     * Counts a shared TX cell with the neighbor of this CSMA, advancing its own epoch by one
+     */
+    void countSharedCell() { ownEpoch++; }
+    /**
+     * Counts the backoff down against @p epoch from now on (the own epoch if nullptr),
+     * keeping the remaining backoff. The epoch has to outlive this CSMA.
+     */
+    void setEpoch(const long *epoch);
 private:
     /**
      * private variable
@@ -153,9 +160,22 @@ private:
     int BE;
     /**
      * private variable
-     * Represents the current backoff state of the CSMA
+     * Epoch (number of shared cells counted) at which the backoff is over,
+     * the current backoff state (randomNumber) is the distance to it
      */
-    int randomNumber;
+    long backoffEnd;
+    /**
+     * private variable
+     * Number of shared TX cells with the neighbor of this CSMA
+     */
+    long ownEpoch;
+    /**
+     * private variable
+     * Epoch to count down against instead of ownEpoch, e.g. all broadcast shared cells
+     */
+    const long *sharedEpoch;
+
+    long currentEpoch() const { return sharedEpoch ? *sharedEpoch : ownEpoch; }
     /**
      * Shows the minimum backoff exponent
      */
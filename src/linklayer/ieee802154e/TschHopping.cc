@@ -27,6 +27,7 @@
 #include <omnetpp/cstringtokenizer.h>
 #include "inet/common/Units.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <list>
 #include <numeric>
@@ -39,7 +40,10 @@ using namespace inet;
 
 Define_Module(TschHopping);
 
-TschHopping::TschHopping() {}
+TschHopping::TschHopping()
+    : tableWidth(0), tableRevision(0), lastAsn(-1), lastRow(0)
+{
+}
 
 TschHopping::~TschHopping() {}
 
@@ -72,25 +76,59 @@ void TschHopping::initialize(int stage)
             EV_DETAIL << "Generating hopping pattern randomly" << endl;
             std::list<int> l(numChannels);
             std::iota(l.begin(), l.end(), getMinChannel());
-            std::copy(l.begin(), l.end(), std::back_inserter(pattern));
+            std::copy(l.begin(), l.end(), std::back_inserter(basePattern));
 
             std::mt19937 e((unsigned int) intrand(100));
-            std::shuffle(pattern.begin(), pattern.end(), e);
+            std::shuffle(basePattern.begin(), basePattern.end(), e);
         } else {
             EV_DETAIL << "Reading hopping pattern from string" << endl;
-            pattern = omnetpp::cStringTokenizer(patternstr).asIntVector();
+            basePattern = omnetpp::cStringTokenizer(patternstr).asIntVector();
         }
 
-        if (blacklistedChannels.size()) {
-            remove_intersection(pattern, blacklistedChannels);
-            EV_DETAIL << "Found (and removed) blacklisted channels: " << blacklistedChannels << endl;
-        }
+        applyBlacklist();
+    }
+}
 
-        EV_DETAIL << "Hopping pattern: " << pattern << endl;
+void TschHopping::applyBlacklist()
+{
+    pattern = basePattern;
 
-        // at least one channel in hopping sequence
-        assert(pattern.size() >= 1);
+    if (blacklistedChannels.size()) {
+        remove_intersection(pattern, blacklistedChannels);
+        EV_DETAIL << "Found (and removed) blacklisted channels: " << blacklistedChannels << endl;
     }
+
+    EV_DETAIL << "Hopping pattern: " << pattern << endl;
+
+    // at least one channel in hopping sequence
+    if (pattern.empty())
+        throw cRuntimeError("Hopping pattern is empty after removing blacklisted channels");
+
+    rebuildTables();
+}
+
+void TschHopping::rebuildTables()
+{
+    minChannel = getMinChannel();
+    maxChannel = getMaxChannel();
+
+    frequencyTable.resize(maxChannel - minChannel + 1);
+    for (int ch = minChannel; ch <= maxChannel; ch++)
+        frequencyTable[ch - minChannel] = getMinCenterFrequency().get() + ((ch - minChannel) * getChannelSpacing().get());
+
+    int size = (int) pattern.size();
+    tableWidth = std::max(size, numChannels);
+    hoppingTable.resize(size * tableWidth);
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < tableWidth; j++) {
+            auto ch = pattern[(i + j) % size];
+            hoppingTable[i * tableWidth + j] = {ch, ch >= minChannel && ch <= maxChannel ? frequencyTable[ch - minChannel] : NAN};
+        }
+
+    // row of ASN -1, so that ASN 0 is the first consecutive one
+    lastAsn = -1;
+    lastRow = size - 1;
+    tableRevision++;
 }
 
 TschHopping::PatternVector TschHopping::getHoppingSequence() {
@@ -111,14 +149,62 @@ int TschHopping::channel(int64_t asn, int channelOffset)
     ASSERT(asn >= 0);
     ASSERT(channelOffset >= 0);
 
+    int size = (int) pattern.size();
+
 //    TODO: ensure existing simulations are not broken by commenting this out
-    if ((int) pattern.size() == 1) {
+    if (size == 1) {
         EV_DETAIL << "Seems channel hopping is disabled" << endl;
 
-        return getMinChannel() + channelOffset;
+        return minChannel + channelOffset;
+    }
+
+    int row;
+    if (asn == lastAsn)
+        row = lastRow;
+    else if (asn == lastAsn + 1)
+        row = lastRow + 1 == size ? 0 : lastRow + 1;
+    else
+        row = (int) (asn % size);
+
+    lastAsn = asn;
+    lastRow = row;
+
+    return hoppingTable[row * tableWidth + tableColumn(channelOffset)].channel;
+}
+
+TschHopping::PatternVector TschHopping::channelsForSlotframe(int64_t asnStart, const PatternVector& channelOffsets,
+        std::vector<double> *frequencies)
+{
+    ASSERT(asnStart >= 0);
+
+    int size = (int) pattern.size();
+    PatternVector channels(channelOffsets.size(), -1);
+    if (frequencies)
+        frequencies->assign(channelOffsets.size(), NAN);
+
+    // walk the rows of the hopping table along with the slots, no modulo per slot
+    int row = (int) (asnStart % size);
+    for (size_t slotOffset = 0; slotOffset < channelOffsets.size(); slotOffset++) {
+        auto chOf = channelOffsets[slotOffset];
+        if (chOf >= 0) {
+            if (size == 1) {
+                channels[slotOffset] = minChannel + chOf;
+                if (frequencies && channels[slotOffset] <= maxChannel)
+                    (*frequencies)[slotOffset] = frequencyTable[chOf];
+            }
+            else {
+                auto &entry = hoppingTable[row * tableWidth + tableColumn(chOf)];
+                channels[slotOffset] = entry.channel;
+                if (frequencies)
+                    (*frequencies)[slotOffset] = entry.frequency;
+            }
+        }
+
+        if (++row == size)
+            row = 0;
     }
 
-    return pattern[(asn + channelOffset) % pattern.size()];
+    return channels;
 }
 
 int TschHopping::getMinChannel() {
@@ -143,16 +229,13 @@ units::values::Hz TschHopping::getMaxCenterFrequency(){
 
 units::values::Hz TschHopping::channelToCenterFrequency(int channel)
 {
-   ASSERT(channel >= getMinChannel());
-   ASSERT(channel <= getMaxChannel());
-   return units::values::Hz(getMinCenterFrequency().get() + ((channel - getMinChannel()) * getChannelSpacing().get()));
+   return units::values::Hz(channelToCenterFrequencyPlain(channel));
 }
 
 double TschHopping::channelToCenterFrequencyPlain(int channel)
 {
-   ASSERT(channel >= getMinChannel());
-   ASSERT(channel <= getMaxChannel());
-   return getMinCenterFrequency().get() + ((channel - getMinChannel()) * getChannelSpacing().get());
+   ASSERT(channel >= minChannel && channel <= maxChannel);
+   return frequencyTable[channel - minChannel];
 }
 
 
@@ -43,20 +43,43 @@ class TschHopping: public omnetpp::cSimpleModule, public IChannelPlan
 
         int channel(int64_t asn, int channelOffset);
 
+        /**
+         * Channels of a whole slotframe starting at @p asnStart at once.
+         *
+         * @param asnStart        ASN of the first slot (slot offset 0) of the slotframe
+         * @param channelOffsets  channel offset used in each slot of the slotframe, -1 for unused slots
+         * @param frequencies     if given, filled with the center frequency of each slot, NaN for unused slots
+         * @return                channel for each slot, -1 for unused slots
+         */
+        PatternVector channelsForSlotframe(int64_t asnStart, const PatternVector& channelOffsets,
+                std::vector<double> *frequencies = nullptr);
+
+        /** Incremented whenever the hopping tables are rebuilt, lets callers invalidate cached channels */
+        unsigned int getTableRevision() const {
+            return tableRevision;
+        }
+
         const PatternVector& getPattern() const {
             return pattern;
         }
 
+        /** Sets the hopping pattern, blacklisted channels are removed from it */
         void setPattern(const PatternVector& pattern) {
-            this->pattern = pattern;
+            this->basePattern = pattern;
+            applyBlacklist();
         }
 
         const PatternVector& getBlacklistedChannels() const {
             return blacklistedChannels;
         }
 
+        /**
+         * Sets the blacklisted channels, the hopping pattern is filtered anew from the
+         * configured one, so channels dropped from the blacklist rejoin the pattern
+         */
         void setBlacklistedChannels(const PatternVector& blChannels) {
             this->blacklistedChannels = blChannels;
+            applyBlacklist();
         }
 
         /** Get the lowest/highest channel number for the given frequency band (WAIC or ISM) */
@@ -92,11 +115,44 @@ class TschHopping: public omnetpp::cSimpleModule, public IChannelPlan
 //            return out;
 //        }
 
+    protected:
+        /** Filter the configured pattern by the blacklist and rebuild the tables */
+        void applyBlacklist();
+
+        /** Precompute the hopping and frequency tables, needed after any pattern change */
+        void rebuildTables();
+
+        inline int tableColumn(int channelOffset) const {
+            return channelOffset < tableWidth ? channelOffset : channelOffset % (int) pattern.size();
+        }
+
     private:
+        PatternVector basePattern; // as configured, before removing blacklisted channels
         PatternVector pattern;
         PatternVector blacklistedChannels;
         units::values::Hz centerFrequency;
         int numChannels;
+
+        struct HopEntry {
+            int channel;
+            double frequency;
+        };
+
+        // hoppingTable[i * tableWidth + j] holds the channel (and its center frequency)
+        // of channel offset j at any ASN with ASN % pattern.size() == i, the table is wide
+        // enough for every channel offset below nbRadioChannels to need no modulo
+        std::vector<HopEntry> hoppingTable;
+        int tableWidth;
+        unsigned int tableRevision;
+
+        // row of the last lookup, consecutive ASNs advance it without a modulo
+        int64_t lastAsn;
+        int lastRow;
+
+        // center frequency of each channel, indexed by (channel - minChannel)
+        std::vector<double> frequencyTable;
+        int minChannel;
+        int maxChannel;
 };
 
 } // namespace tsch
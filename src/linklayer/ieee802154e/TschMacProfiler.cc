@@ -0,0 +1,91 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <omnetpp.h>
+
+#include "TschMacProfiler.h"
+
+namespace tsch {
+
+std::vector<TschMacProfiler::Entry> TschMacProfiler::networkEntries;
+int TschMacProfiler::numActive = 0;
+bool TschMacProfiler::fileStarted = false;
+
+TschMacProfiler::TschMacProfiler(const std::vector<std::string>& stateNames, const std::vector<std::string>& eventNames)
+    : stateNames(stateNames)
+    , eventNames(eventNames)
+    , numEvents(eventNames.size())
+    , entries(stateNames.size() * eventNames.size())
+    , finished(false)
+{
+    if (!numActive) {
+        networkEntries.assign(entries.size(), Entry());
+        fileStarted = false;
+    }
+    numActive++;
+}
+
+TschMacProfiler::~TschMacProfiler()
+{
+    // run ended without finish(), don't let it leak into the totals of the next one
+    if (!finished)
+        numActive--;
+}
+
+void TschMacProfiler::writeTable(const std::string& filename, const std::string& nodeName)
+{
+    if (finished)
+        return;
+    finished = true;
+    numActive--;
+
+    for (size_t i = 0; i < entries.size() && i < networkEntries.size(); i++) {
+        networkEntries[i].count += entries[i].count;
+        networkEntries[i].wallTime += entries[i].wallTime;
+    }
+
+    std::ofstream out(filename, fileStarted ? std::ios::app : std::ios::trunc);
+    if (!out)
+        throw omnetpp::cRuntimeError("Cannot open MAC profiling output file `%s'", filename.c_str());
+
+    if (!fileStarted) {
+        out << "node,state,event,count,wallTimeNs" << std::endl;
+        fileStarted = true;
+    }
+
+    writeRows(out, nodeName, entries);
+    if (!numActive)
+        writeRows(out, "network", networkEntries);
+}
+
+void TschMacProfiler::writeRows(std::ostream& out, const std::string& nodeName, const std::vector<Entry>& rows)
+{
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (!rows[i].count)
+            continue;
+
+        out << nodeName << "," << stateNames[i / numEvents] << "," << eventNames[i % numEvents] << ","
+                << rows[i].count << ","
+                << std::chrono::duration_cast<std::chrono::nanoseconds>(rows[i].wallTime).count() << std::endl;
+    }
+}
+
+} // namespace tsch
@@ -0,0 +1,96 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TSCH_TSCHMACPROFILER_H_
+#define __TSCH_TSCHMACPROFILER_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace tsch {
+
+/**
+ * @brief Event counts and wall-clock time of the TSCH MAC state machine,
+ *        per (state, event) pair.
+ *
+ * Only created by the MAC if profiling is enabled (see profileFsm in
+ * Ieee802154eMac.ned), so a disabled profiler costs a single null pointer check
+ * per event. All profilers of a run also add up to network-wide totals, which are
+ * written by the last one to finish. The output is a CSV table with the columns
+ *
+ *   node,state,event,count,wallTimeNs
+ *
+ * where node is the full path of the MAC module or "network" for the totals.
+ */
+class TschMacProfiler
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param stateNames    name of each state, indexed by state value
+     * @param eventNames    name of each event, indexed by event value
+     */
+    TschMacProfiler(const std::vector<std::string>& stateNames, const std::vector<std::string>& eventNames);
+    ~TschMacProfiler();
+
+    static Clock::time_point now() { return Clock::now(); }
+
+    /** Account for one @p event handled in @p state, which started at @p start */
+    void record(int state, int event, Clock::time_point start) {
+        auto& entry = entries[state * numEvents + event];
+        entry.count++;
+        entry.wallTime += Clock::now() - start;
+    }
+
+    /**
+     * Write the table of node @p nodeName to @p filename, followed by the
+     * network-wide table if this is the last profiler to finish.
+     * The first profiler of a run to finish truncates the file.
+     */
+    void writeTable(const std::string& filename, const std::string& nodeName);
+
+  protected:
+    struct Entry {
+        long count = 0;
+        Clock::duration wallTime = Clock::duration::zero();
+    };
+
+    std::vector<std::string> stateNames;
+    std::vector<std::string> eventNames;
+    int numEvents;
+    std::vector<Entry> entries;
+    bool finished;
+
+    void writeRows(std::ostream& out, const std::string& nodeName, const std::vector<Entry>& rows);
+
+  private:
+    /** Sum of all profilers of the current run */
+    static std::vector<Entry> networkEntries;
+    /** Number of profilers that haven't written their table yet */
+    static int numActive;
+    /** Whether the output file has already been (re)started in this run */
+    static bool fileStarted;
+};
+
+} // namespace tsch
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "TschMicroBenchmark.h"
+
+namespace tsch {
+
+Define_Module(TschMicroBenchmark);
+
+TschMicroBenchmark::~TschMicroBenchmark()
+{
+    cancelAndDelete(startMsg);
+    delete packet;
+}
+
+void TschMicroBenchmark::initialize()
+{
+    schedule = check_and_cast<TschSlotframe *>(getModuleByPath("^.schedule"));
+    linkInfo = check_and_cast<TschLinkInfo *>(getModuleByPath("^.linkinfo"));
+    neighbor = check_and_cast<TschNeighbor *>(getModuleByPath("^.neighbor"));
+
+    numCalls = par("numCalls");
+    numChannels = par("numChannels");
+    numNeighborAddresses = par("numNeighborAddresses");
+
+    // sizes are reached by adding to the previous one, hence ascending
+    linkCounts = cStringTokenizer(par("linkCounts")).asIntVector();
+    neighborCounts = cStringTokenizer(par("neighborCounts")).asIntVector();
+    std::sort(linkCounts.begin(), linkCounts.end());
+    std::sort(neighborCounts.begin(), neighborCounts.end());
+
+    std::string outputFile = par("outputFile").stdstringValue();
+    if (!outputFile.empty()) {
+        output.open(outputFile);
+        if (!output)
+            throw cRuntimeError("Cannot open benchmark output file `%s'", outputFile.c_str());
+        output << "function,size,calls,nsPerCall" << std::endl;
+    }
+
+    packet = new inet::Packet("benchmark");
+
+    // all other modules are initialized by the time the first event runs
+    startMsg = new cMessage("startBenchmark");
+    scheduleAt(simTime(), startMsg);
+}
+
+void TschMicroBenchmark::handleMessage(cMessage *msg)
+{
+    if (msg != startMsg)
+        throw cRuntimeError("Unexpected message %s", msg->getName());
+
+    std::cout << std::left << std::setw(24) << "function" << std::setw(16) << "size"
+            << std::right << std::setw(12) << "ns/call" << std::endl;
+
+    benchmarkSchedule();
+    benchmarkNeighbor();
+}
+
+void TschMicroBenchmark::finish()
+{
+    recordScalar("checksum", (double) checksum);
+}
+
+void TschMicroBenchmark::addRandomLink()
+{
+    int slotOffset = intuniform(0, schedule->getMacSlotframeSize() - 1);
+    int channelOffset = intuniform(0, numChannels - 1);
+    uint64_t nodeId = intuniform(1, numNeighborAddresses);
+
+    auto link = schedule->createLink();
+    link->setSlotOffset(slotOffset);
+    link->setChannelOffset(channelOffset);
+    link->setAddr(inet::MacAddress(nodeId));
+    link->setTx(true);
+    link->setNormal(true);
+    schedule->addLink(link);
+
+    if (!linkInfo->linkInfoExists(nodeId))
+        linkInfo->addLink(nodeId, false, 0, 0);
+    // fails if the node already has a cell in this slot, which is fine here
+    linkInfo->addCell(nodeId, {(offset_t) slotOffset, (offset_t) channelOffset}, MAC_LINKOPTIONS_TX);
+}
+
+void TschMicroBenchmark::benchmarkSchedule()
+{
+    int slotframeSize = schedule->getMacSlotframeSize();
+
+    // random lookups, drawn once so the RNG doesn't show up in the timings
+    std::vector<cellLocation_t> cells(1024);
+    for (auto& cell : cells)
+        cell = {(offset_t) intuniform(0, slotframeSize - 1), (offset_t) intuniform(0, numChannels - 1)};
+
+    for (auto numLinks : linkCounts) {
+        while (schedule->getNumLinks() < numLinks)
+            addRandomLink();
+
+        measure("getLinksFromASN", "links", numLinks,
+                [&](long i) { checksum += schedule->getLinksFromASN(i).size(); });
+        measure("getASNofNextLink", "links", numLinks,
+                [&](long i) { checksum += schedule->getASNofNextLink(i); });
+        measure("timeOffsetScheduled", "links", numLinks,
+                [&](long i) { checksum += linkInfo->timeOffsetScheduled(i % slotframeSize); });
+        measure("getNodeOfCell", "links", numLinks,
+                [&](long i) { checksum += linkInfo->getNodeOfCell(cells[i % cells.size()]); });
+    }
+}
+
+void TschMicroBenchmark::benchmarkNeighbor()
+{
+    int queueLength = neighbor->par("queueLength");
+
+    for (auto numNeighbors : neighborCounts) {
+        // fill every queue of the neighbors to the limit, then flush them (not timed)
+        Clock::duration elapsed = Clock::duration::zero();
+        long calls = 0;
+        std::vector<inet::Packet *> packets(numNeighbors * queueLength);
+        while (calls < numCalls) {
+            for (auto& p : packets)
+                p = packet->dup();
+
+            auto start = Clock::now();
+            enqueue(packets, numNeighbors);
+            elapsed += Clock::now() - start;
+            calls += numNeighbors * queueLength;
+
+            for (int nbr = 1; nbr <= numNeighbors; nbr++)
+                neighbor->flushQueue(inet::MacAddress(nbr), LINK_PRIO_NORMAL);
+        }
+        report("add2Queue", "neighbors", numNeighbors, calls, elapsed);
+
+        for (auto& p : packets)
+            p = packet->dup();
+        enqueue(packets, numNeighbors);
+        measure("getTotalQueueSize", "neighbors", numNeighbors,
+                [&](long i) { checksum += neighbor->getTotalQueueSize(); });
+        for (int nbr = 1; nbr <= numNeighbors; nbr++)
+            neighbor->flushQueue(inet::MacAddress(nbr), LINK_PRIO_NORMAL);
+    }
+}
+
+void TschMicroBenchmark::enqueue(const std::vector<inet::Packet *>& packets, int numNeighbors)
+{
+    for (int i = 0; i < (int) packets.size(); i++) {
+        bool added = neighbor->add2Queue(packets[i], inet::MacAddress(1 + i % numNeighbors), LINK_PRIO_NORMAL);
+        checksum += added;
+        if (!added)
+            delete packets[i];
+    }
+}
+
+void TschMicroBenchmark::report(const char *function, const char *sizeName, int size, long calls, Clock::duration elapsed)
+{
+    double nsPerCall = std::chrono::duration<double, std::nano>(elapsed).count() / std::max(calls, 1L);
+    std::string sizeStr = std::string(sizeName) + "=" + std::to_string(size);
+
+    std::cout << std::left << std::setw(24) << function << std::setw(16) << sizeStr
+            << std::right << std::setw(12) << std::fixed << std::setprecision(1) << nsPerCall << std::endl;
+    recordScalar((std::string(function) + ":nsPerCall(" + sizeStr + ")").c_str(), nsPerCall);
+
+    if (output.is_open())
+        output << function << "," << size << "," << calls << "," << nsPerCall << std::endl;
+}
+
+} // namespace tsch
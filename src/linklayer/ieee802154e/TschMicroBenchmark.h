@@ -0,0 +1,101 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TSCH_TSCHMICROBENCHMARK_H_
+#define __TSCH_TSCHMICROBENCHMARK_H_
+
+#include <chrono>
+#include <fstream>
+#include <omnetpp.h>
+
+#include "TschSlotframe.h"
+#include "TschNeighbor.h"
+#include "sixtisch/TschLinkInfo.h"
+
+using namespace omnetpp;
+
+namespace tsch {
+
+/**
+ * @brief Times the hot lookups of the MAC data structures (TschSlotframe,
+ *        TschLinkInfo, TschNeighbor and its TschCSMA instances) directly,
+ *        without a radio, MAC or any other node around them.
+ *
+ * Lives next to a schedule, neighbor and linkinfo module (see MicroBenchmark.ned
+ * in the simulations folder), fills them with random links and queued packets of
+ * growing size and prints the wall-clock time per call of each method. The whole
+ * run takes a few seconds and schedules no events apart from its start message.
+ */
+class TschMicroBenchmark : public cSimpleModule
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    TschMicroBenchmark() : startMsg(nullptr), packet(nullptr), checksum(0) {}
+    virtual ~TschMicroBenchmark();
+
+  protected:
+    TschSlotframe *schedule;
+    TschLinkInfo *linkInfo;
+    TschNeighbor *neighbor;
+
+    long numCalls;
+    int numChannels;
+    int numNeighborAddresses;
+    std::vector<int> linkCounts;
+    std::vector<int> neighborCounts;
+    std::ofstream output;
+
+    cMessage *startMsg;
+    /** Duplicated for the packets enqueued by the add2Queue benchmark, flushing the queues deletes them */
+    inet::Packet *packet;
+    /** Sum of all return values, keeps the compiler from dropping the calls */
+    uint64_t checksum;
+
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    /** Times getLinksFromASN, getASNofNextLink, timeOffsetScheduled and getNodeOfCell */
+    void benchmarkSchedule();
+    /** Times add2Queue and getTotalQueueSize */
+    void benchmarkNeighbor();
+
+    /** Enqueues @p packets round robin to neighbors 1 .. @p numNeighbors, deleting those rejected */
+    void enqueue(const std::vector<inet::Packet *>& packets, int numNeighbors);
+
+    /** Adds a random TX link to the schedule and the matching cell to the link info */
+    void addRandomLink();
+
+    /** Calls @p call with the indices 0 .. numCalls - 1 and reports the average time */
+    template<typename Call>
+    void measure(const char *function, const char *sizeName, int size, Call call) {
+        auto start = Clock::now();
+        for (long i = 0; i < numCalls; i++)
+            call(i);
+        report(function, sizeName, size, numCalls, Clock::now() - start);
+    }
+
+    void report(const char *function, const char *sizeName, int size, long calls, Clock::duration elapsed);
+};
+
+} // namespace tsch
+
+#endif
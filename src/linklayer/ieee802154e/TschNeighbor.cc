@@ -21,6 +21,8 @@
 
 #include "TschNeighbor.h"
 #include "TschVirtualLink.h"
+#include "../../common/TrafficClassTag_m.h"
+#include "../../common/TschSimsignals.h"
 #include "inet/common/INETUtils.h"
 #include <iostream>
 #include <algorithm>
@@ -32,7 +34,27 @@ namespace tsch{
 Define_Module(TschNeighbor);
 
 TschNeighbor::~TschNeighbor() {
+    clearQueue();
+}
 
+void TschNeighbor::PacketRing::push_back(inet::Packet *packet) {
+    if (count == (int) buffer.size()) {
+        // grow to the next power of two, unrolling the ring
+        std::vector<inet::Packet *> grown(buffer.empty() ? 4 : 2 * buffer.size());
+        for (int i = 0; i < count; i++)
+            grown[i] = at(i);
+        buffer.swap(grown);
+        head = 0;
+    }
+    buffer[(head + count) & (buffer.size() - 1)] = packet;
+    count++;
+}
+
+void TschNeighbor::PacketRing::pop_front() {
+    if (!count)
+        return;
+    head = (head + 1) & (buffer.size() - 1);
+    count--;
 }
 
 void TschNeighbor::initialize(int stage){
@@ -48,8 +70,15 @@ void TschNeighbor::initialize(int stage){
         this->W_nq = 1;
         this->C_npq = this->W_npq;
         this->C_nq = this->W_nq;
+        this->totalQueueSize = 0;
+        this->broadcastEpoch = 0;
         macMaxBe = par("macMaxBe").intValue();
         macMinBe = par("macMinBe").intValue();
+
+        schedule = check_and_cast<TschSlotframe *>(getModuleByPath("^.schedule"));
+        schedule->subscribe(linkAddedSignal, this);
+        schedule->subscribe(linkDeletedSignal, this);
+        schedule->subscribe(linkChangedSignal, this);
     }else if(stage == 5){
         hostNode = getModuleByPath("^.^.^.");
     }
@@ -59,6 +88,34 @@ void TschNeighbor::initialize(int stage){
 void TschNeighbor::handleMessage(cMessage *msg) {
     throw cRuntimeError("This module doesn't process messages");
 }
+
+int TschNeighbor::getNeighborHandle(MacAddress macAddr, bool create) {
+    auto it = neighborHandles.find(macAddr.getInt());
+    if (it != neighborHandles.end())
+        return it->second;
+
+    if (!create)
+        return -1;
+
+    int handle = (int) neighborTable.size();
+    neighborTable.emplace_back();
+    neighborTable.back().macAddr = macAddr;
+    neighborHandles[macAddr.getInt()] = handle;
+
+    return handle;
+}
+
+TschNeighbor::Queue TschNeighbor::getLane(NeighborEntry& entry, int virtualLinkId, bool create) {
+    if (virtualLinkId >= LINK_PRIO_CONTROL && virtualLinkId <= LINK_PRIO_LOW)
+        return &entry.lanes[virtualLinkId - LINK_PRIO_CONTROL];
+
+    auto it = entry.customLanes.find(virtualLinkId);
+    if (it != entry.customLanes.end())
+        return &it->second;
+
+    return create ? &entry.customLanes[virtualLinkId] : nullptr;
+}
+
 // New virtual queue
 bool TschNeighbor::add2Queue(Packet *packet,MacAddress macAddr, int virtualLinkId) {
     // Priority queue disabled but virtualLinkID modified??
@@ -67,108 +124,75 @@ bool TschNeighbor::add2Queue(Packet *packet,MacAddress macAddr, int virtualLinkI
     if(!this->enablePriorityQueue && (virtualLinkId == -1))
         virtualLinkId = 0;
 
-    bool added = false;
-    auto macToQueueEntry = this->macToQueueMap.find(macAddr);
-
-    if (macToQueueEntry != macToQueueMap.end())
+    if (neighborHandles.find(macAddr.getInt()) != neighborHandles.end())
         EV_DETAIL << "[TschNeighbor] The given Macaddress: " << macAddr << " is already a Neighbor." << endl;
     else
-    {
         EV_DETAIL << "[TschNeighbor] The given Macaddress: " << macAddr << " is not found. New entry added in Neighbor." << endl;
-        this->macToQueueMap.insert(std::make_pair(macAddr, createVirtualQueue()));
+
+    auto &entry = neighborTable[getNeighborHandle(macAddr, true)];
+
+    EV_DETAIL << "[TschNeighbor] The current queue for this Neighbor is: " << entry.totalSize << endl;
+
+    if (entry.totalSize >= this->queueLength && virtualLinkId != LINK_PRIO_CONTROL) {
+        EV_DETAIL << "[TschNeighbor] The queue of this neighbor is full." << endl;
+        return false;
     }
 
-    //this->macToQueueMap.insert(std::make_pair(macAddr, createVirtualQueue()));
-    // This if clause might be useless
-    macToQueueEntry = this->macToQueueMap.find(macAddr);
-    if (macToQueueEntry != macToQueueMap.end()) {
-        // Insert()checks redundancy
-        macToQueueEntry->second->insert(std::make_pair(-2, createQueue()));
-        macToQueueEntry->second->insert(std::make_pair(-1, createQueue()));
-        macToQueueEntry->second->insert(std::make_pair(0, createQueue()));
-        macToQueueEntry->second->insert(std::make_pair(1, createQueue()));
-        macToQueueEntry->second->insert(std::make_pair(virtualLinkId, createQueue()));
-        auto searchVirtualQueue = macToQueueEntry->second->find(virtualLinkId);
-
-        auto actualQueueSize = getTotalQueueSizeAt(macAddr);
-        EV_DETAIL << "[TschNeighbor] The current queue for this Neighbor is: " << actualQueueSize << endl;
-
-        if (actualQueueSize < this->queueLength || virtualLinkId == LINK_PRIO_CONTROL) {
-            searchVirtualQueue->second->push_back(packet);
-            EV_DETAIL << "[TschNeighbor] Packet is added to the queue." << endl;
-            added = true;
-        }
-        else
-            EV_DETAIL << "[TschNeighbor] The queue of this neighbor is full." << endl;
+    getLane(entry, virtualLinkId, true)->push_back(packet);
+    entry.totalSize++;
+    totalQueueSize++;
+    EV_DETAIL << "[TschNeighbor] Packet is added to the queue." << endl;
+
+    if (!entry.csma) {
+        entry.csma = new TschCSMA(macMinBe, macMaxBe, this->getRNG(0));
+        updateBackoffEpoch(entry);
     }
-    if (added)
-        backoffTable.insert(std::make_pair(macAddr, new TschCSMA(macMinBe, macMaxBe, this->getRNG(0))));
 
-    return added;
+    return true;
 }
 
 int TschNeighbor::getTotalQueueSizeAt(MacAddress macAddress) {
-    auto macToQueueEntry = this->macToQueueMap.find(macAddress);
-    if (macToQueueEntry != this->macToQueueMap.end()) {
-        int queueSize= 0;
-        // iterate over all virtual link IDs, i.e. priority levels
-        for (auto itr = macToQueueEntry->second->begin(); itr != macToQueueEntry->second->end(); ++itr)
-            queueSize += (int)itr->second->size();
-
-        return queueSize;
-    } else {
+    auto handle = getNeighborHandle(macAddress);
+    if (handle < 0) {
         EV_DETAIL << "[TschNeighbor] This Neighbor does not exist." << endl;
         return 0;
     }
+
+    return neighborTable[handle].totalSize;
 }
 
 int TschNeighbor::getTotalQueueSize() {
-    int queueSize = 0;
-
-    // iterate over all neighbors
-    for (auto macToQueueEntry : this->macToQueueMap)
-    {
-        // iterate over all virtual link IDs, i.e. priority levels
-        for (auto itr = macToQueueEntry.second->begin(); itr != macToQueueEntry.second->end(); ++itr)
-            queueSize += (int)itr->second->size();
-    }
-
-    return queueSize;
+    return totalQueueSize;
 }
 
 int TschNeighbor::getVirtualQueueSizeAt(MacAddress macAddress, int virtualLinkId) {
-    auto entry = this->macToQueueMap.find(macAddress);
-    if (entry == this->macToQueueMap.end())
-        return 0;
-
-    auto virtualQueue = entry->second->find(virtualLinkId);
-    if (virtualQueue == entry->second->end())
+    auto handle = getNeighborHandle(macAddress);
+    if (handle < 0)
         return 0;
 
-    return (int) virtualQueue->second->size();
+    auto virtualQueue = getLane(neighborTable[handle], virtualLinkId);
+    return virtualQueue ? virtualQueue->size() : 0;
 }
 
 void TschNeighbor::setVirtualQueue(MacAddress macAddr, int linkId) {
     this->currentNeighborKey = macAddr;
     this->currentVirtualLinkIDKey = linkId;
+
+    auto handle = getNeighborHandle(macAddr);
+    current.entry = handle < 0 ? nullptr : &neighborTable[handle];
+    current.lane = current.entry ? getLane(*current.entry, linkId) : nullptr;
     EV_DETAIL << "[TschNeighbor] Selected neighbor " << macAddr
         << " and virtual link ID " << this->currentVirtualLinkIDKey << endl;
 }
 
 int TschNeighbor::getCurrentNeighborQueueSize(){
-    int queueSize = 0;
-    auto search = this->macToQueueMap.find(this->currentNeighborKey);
-    if (search != this->macToQueueMap.end())
-    {
-        for(auto itr = search->second->begin(); itr != search->second->end(); ++itr)
-            queueSize += (int)itr->second->size();
-
-        EV_DETAIL << "[TschNeighbor] The queue size for the current neighbor is: " << queueSize << endl;
-        return queueSize;
-    } else {
+    if (!current.entry) {
         EV_DETAIL << "[TschNeighbor] This Neighbor does not exist." << endl;
-        return queueSize;
+        return 0;
     }
+
+    EV_DETAIL << "[TschNeighbor] The queue size for the current neighbor is: " << current.entry->totalSize << endl;
+    return current.entry->totalSize;
 }
 
 int TschNeighbor::getCurrentVirtualLinkIDKey(){
@@ -176,45 +200,49 @@ int TschNeighbor::getCurrentVirtualLinkIDKey(){
 }
 
 inet::Packet* TschNeighbor::getCurrentNeighborQueueFirstPacket(){
-    return this->macToQueueMap.find(this->currentNeighborKey)->second->find(this->currentVirtualLinkIDKey)->second->front();
+    if (!current.lane || current.lane->empty())
+        return nullptr;
+
+    return current.lane->front();
 }
 void TschNeighbor::removeFirstPacketFromQueue(){
-    auto searchNeighbor = this->macToQueueMap.find(this->currentNeighborKey);
-    auto searchVirtualQueue = searchNeighbor->second->find(this->currentVirtualLinkIDKey);
-    if((int)searchVirtualQueue->second->size()>0){
-        searchVirtualQueue->second->pop_front();
+    if (current.lane && current.lane->size() > 0) {
+        current.lane->pop_front();
+        current.entry->totalSize--;
+        totalQueueSize--;
         EV_DETAIL << "[Remove] The packet has been successfully removed." << endl;
     }
 }
 
 void TschNeighbor::flushQueue(MacAddress neighbor, int vlinkId) {
-    auto neighborQueueInfo = this->macToQueueMap.find(neighbor);
-    if (neighborQueueInfo == this->macToQueueMap.end())
+    auto handle = getNeighborHandle(neighbor);
+    if (handle < 0)
         return;
 
-    auto virtualQueue = neighborQueueInfo->second->find(vlinkId);
-    if (virtualQueue == neighborQueueInfo->second->end())
+    auto &entry = neighborTable[handle];
+    auto virtualQueue = getLane(entry, vlinkId);
+    if (!virtualQueue)
         return;
 
-    virtualQueue->second->clear();
+    entry.totalSize -= virtualQueue->size();
+    totalQueueSize -= virtualQueue->size();
+    for (int i = 0; i < virtualQueue->size(); i++)
+        delete virtualQueue->at(i);
+    virtualQueue->clear();
 
     EV_DETAIL << "Flushed the queue with virtual link ID " << vlinkId << " for " << neighbor << endl;
 }
 
 int TschNeighbor::getNumBurstyPktsInQueue() {
-    auto neighborQueueInfo = this->macToQueueMap.find(this->currentNeighborKey);
-    if (neighborQueueInfo == this->macToQueueMap.end())
+    if (!current.entry)
         return 0;
 
-    auto virtualQueue = neighborQueueInfo->second->find(LINK_PRIO_NORMAL);
-    if (virtualQueue == neighborQueueInfo->second->end())
-        return 0;
+    auto virtualQueue = getLane(*current.entry, LINK_PRIO_NORMAL);
 
     auto numBurstyPkts = 0;
-    for (auto pkt: *(virtualQueue->second)) {
-        std::string pktName(pkt->getFullName());
-        // FIXME: hardcoded
-        if (pktName.find("Bursty") != std::string::npos)
+    for (int i = 0; i < virtualQueue->size(); i++) {
+        auto tag = virtualQueue->at(i)->findTag<TrafficClassTag>();
+        if (tag && (tag->getTrafficClass() & TC_BURSTY))
             numBurstyPkts++;
     }
 
@@ -223,37 +251,37 @@ int TschNeighbor::getNumBurstyPktsInQueue() {
 
 void TschNeighbor::flush6pQueue(MacAddress neighbor) {
     EV_DETAIL << "Flushing queue with " << neighbor << endl;
-    auto neighborQueueInfo = this->macToQueueMap.find(neighbor);
-    if (neighborQueueInfo == this->macToQueueMap.end())
+    auto handle = getNeighborHandle(neighbor);
+    if (handle < 0)
         return;
 
-    auto virtualQueue = neighborQueueInfo->second->find(LINK_PRIO_CONTROL);
-    if (virtualQueue == neighborQueueInfo->second->end())
-        return;
+    auto &entry = neighborTable[handle];
+    auto virtualQueue = getLane(entry, LINK_PRIO_CONTROL);
 
-    EV_DETAIL << "control queue before: " << printPacketQueue(virtualQueue->second) << endl;
+    EV_DETAIL << "control queue before: " << printPacketQueue(virtualQueue) << endl;
 
-    virtualQueue->second->remove_if(
+    auto removed = virtualQueue->remove_if(
             [](Packet *pkt) {
-                std::string pktName(pkt->getFullName());
-                return pktName.find("6top") != std::string::npos;
+                auto tag = pkt->findTag<TrafficClassTag>();
+                if (!tag || !(tag->getTrafficClass() & TC_SIXP))
+                    return false;
+
+                delete pkt;
+                return true;
             });
+    entry.totalSize -= removed;
+    totalQueueSize -= removed;
 
-    EV_DETAIL << "control queue after:  " << printPacketQueue(virtualQueue->second) << endl;
+    EV_DETAIL << "control queue after:  " << printPacketQueue(virtualQueue) << endl;
 }
 
 TschCSMA* TschNeighbor::getCurrentTschCSMA(){
-    if (this->backoffTable.find(currentNeighborKey) != this->backoffTable.end())
-        return this->backoffTable.find(currentNeighborKey)->second;
-
-    return nullptr;
+    return current.entry ? current.entry->csma : nullptr;
 }
 
 TschCSMA* TschNeighbor::getTschCsmaWith(MacAddress neighborAddr) {
-    if (this->backoffTable.find(neighborAddr) != this->backoffTable.end())
-            return this->backoffTable.find(neighborAddr)->second;
-
-    return nullptr;
+    auto handle = getNeighborHandle(neighborAddr);
+    return handle < 0 ? nullptr : neighborTable[handle].csma;
 }
 
 void TschNeighbor::terminateTschCsmaWith(MacAddress neighborAddr) {
@@ -270,15 +298,16 @@ void TschNeighbor::failedTX(){
 
 void TschNeighbor::terminateCurrentTschCSMA(){
     EV_DETAIL << "Terminating CSMA with " << currentNeighborKey << endl;
-    if (this->getCurrentTschCSMA())
-        this->getCurrentTschCSMA()->terminate();
+    auto csma = getCurrentTschCSMA();
+    if (csma)
+        csma->terminate();
 }
 
 void TschNeighbor::reset() {
-    this->addr.setAddress(inet::MacAddress::UNSPECIFIED_ADDRESS.str().c_str());
     this->dedicated = false;
     this->currentVirtualLinkIDKey = -2;
-    this->currentNeighborKey.setAddress(inet::MacAddress::UNSPECIFIED_ADDRESS.str().c_str());
+    this->currentNeighborKey = inet::MacAddress::UNSPECIFIED_ADDRESS;
+    this->current.clear();
 }
 
 void TschNeighbor::setDedicated(bool value){
@@ -317,72 +346,78 @@ bool TschNeighbor::getCurrentTschCSMAStatus() {
     return this->getCurrentTschCSMA()->getTschCSMAStatus();
 }
 
-void TschNeighbor::updateAllBackoffWindows(inet::MacAddress destAddress, TschSlotframe* sf){
-    bool isBroadcast = destAddress.isBroadcast();
-    for(auto itr = this->backoffTable.begin(); itr != this->backoffTable.end(); ++itr){
-        if (itr->second->getRandomNumber() != 0) {
-            bool hasTxLink = sf->hasLink(itr->first);
-            if ((!hasTxLink && isBroadcast)
-                    || (hasTxLink && (destAddress == itr->first))) {
-                itr->second->decrementRandomNumber();
-            }
-        }
-    }
-}
+void TschNeighbor::countSharedTxCell(inet::MacAddress destAddress){
+    // neighbors without a TX link follow the broadcast epoch, the others their own
+    if (destAddress.isBroadcast())
+        broadcastEpoch++;
 
-std::map<inet::MacAddress, std::map<int, std::list<inet::Packet *>*>*>* TschNeighbor::getMacToQueueMap(){
-    return &this->macToQueueMap;
+    auto handle = getNeighborHandle(destAddress);
+    if (handle >= 0 && neighborTable[handle].csma)
+        neighborTable[handle].csma->countSharedCell();
 }
 
-std::map<inet::MacAddress,TschCSMA*>* TschNeighbor::getBackoffTable(){
-    return &this->backoffTable;
+void TschNeighbor::updateBackoffEpoch(NeighborEntry& entry){
+    entry.hasTxLink = schedule->hasLink(entry.macAddr);
+    entry.csma->setEpoch(entry.hasTxLink ? nullptr : &broadcastEpoch);
 }
 
-std::list<inet::Packet *>* TschNeighbor::createQueue(){
-    return new std::list<inet::Packet *>;
-}
+void TschNeighbor::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details){
+    Enter_Method_Silent();
 
+    auto refresh = [this](NeighborEntry &entry) {
+        if (entry.csma && entry.hasTxLink != schedule->hasLink(entry.macAddr))
+            updateBackoffEpoch(entry);
+    };
 
+    // a changed link may have had another address before, hence check all neighbors
+    if (signalID == linkChangedSignal) {
+        for (auto &entry : neighborTable)
+            refresh(entry);
+        return;
+    }
 
-std::map<int, std::list<inet::Packet *>*>* TschNeighbor::createVirtualQueue(){
-    return new std::map<int, std::list<inet::Packet *>*>;
+    auto handle = getNeighborHandle(check_and_cast<TschLink *>(obj)->getAddr());
+    if (handle >= 0)
+        refresh(neighborTable[handle]);
 }
 
 void TschNeighbor::printQueue() {
-    for (auto outer = this->macToQueueMap.begin(); outer != this->macToQueueMap.end(); ++outer)
+    for (auto &entry : neighborTable)
     {
-
-        if (getTotalQueueSizeAt(outer->first) == 0)
+        if (entry.totalSize == 0)
             continue;
 
-        EV_DETAIL << "The MacAddress: " << outer->first << " queue:" << endl;
+        EV_DETAIL << "The MacAddress: " << entry.macAddr << " queue:" << endl;
 
-        for (auto inner = outer->second->begin(); inner != outer->second->end(); ++inner) {
+        for (int i = 0; i < NUM_PRIO_LANES; i++)
+            if (entry.lanes[i].size())
+                EV_DETAIL << "virtualLinkID " << i + LINK_PRIO_CONTROL << " has " << entry.lanes[i].size() << " packets" << endl;
 
-            if (inner->second->size())
-                EV_DETAIL << "virtualLinkID " << inner->first << " has " << inner->second->size() << " packets" << endl;
-        }
+        for (auto &lane : entry.customLanes)
+            if (lane.second.size())
+                EV_DETAIL << "virtualLinkID " << lane.first << " has " << lane.second.size() << " packets" << endl;
     }
 }
 
 
 
 void TschNeighbor::clearQueue(){
-    for (auto itrOuter = this->macToQueueMap.begin();
-            itrOuter != this->macToQueueMap.end(); ++itrOuter) {
-        for (auto itrInner = itrOuter->second->begin();
-                itrInner != itrOuter->second->end(); ++itrInner) {
-            for (auto packet = itrInner->second->begin();
-                    packet != itrInner->second->end(); ++packet) {
-                delete *packet;
-            }
-
-        }
-        //itrOuter->second->clear();
-    }
-    for(auto itr = this->backoffTable.begin(); itr != this->backoffTable.end(); ++itr){
-        delete itr->second;
+    for (auto &entry : neighborTable) {
+        for (int i = 0; i < NUM_PRIO_LANES; i++)
+            for (int n = 0; n < entry.lanes[i].size(); n++)
+                delete entry.lanes[i].at(n);
+
+        for (auto &lane : entry.customLanes)
+            for (int n = 0; n < lane.second.size(); n++)
+                delete lane.second.at(n);
+
+        delete entry.csma;
     }
+
+    current.clear();
+    neighborTable.clear();
+    neighborHandles.clear();
+    totalQueueSize = 0;
 }
 
 void TschNeighbor::refreshDisplay() const {
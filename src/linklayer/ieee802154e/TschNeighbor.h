@@ -27,7 +27,11 @@
 #include "inet/common/packet/Packet.h"
 #include "TschCSMA.h"
 #include "TschSlotframe.h"
+#include "TschVirtualLink.h"
 #include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
 
 using namespace inet;
 namespace tsch{
@@ -36,42 +40,112 @@ namespace tsch{
  */
 class TschNeighbor : public cSimpleModule, protected cListener
 {
+    public:
+        /**
+         * FIFO of packets backed by a ring buffer. The storage only grows up to
+         * the largest number of packets held at once and is reused afterwards.
+         */
+        class PacketRing {
+            public:
+                int size() const { return count; }
+                bool empty() const { return count == 0; }
+                inet::Packet* front() const { return buffer[head]; }
+                inet::Packet* at(int i) const { return buffer[(head + i) & (buffer.size() - 1)]; }
+                void push_back(inet::Packet *packet);
+                void pop_front();
+                void clear() { head = 0; count = 0; }
+
+                /**
+                 * Removes all packets matching @p pred, keeping the order of the rest
+                 * @return number of packets removed
+                 */
+                template<typename Predicate>
+                int remove_if(Predicate pred) {
+                    int kept = 0;
+                    for (int i = 0; i < count; i++) {
+                        auto packet = at(i);
+                        if (!pred(packet))
+                            buffer[(head + kept++) & (buffer.size() - 1)] = packet;
+                    }
+                    int removed = count - kept;
+                    count = kept;
+                    return removed;
+                }
+
+            private:
+                std::vector<inet::Packet *> buffer; // capacity is always a power of two
+                int head = 0;
+                int count = 0;
+        };
+
+        /** Number of fixed priority lanes, LINK_PRIO_CONTROL (-2) to LINK_PRIO_LOW (1) */
+        static const int NUM_PRIO_LANES = LINK_PRIO_LOW - LINK_PRIO_CONTROL + 1;
+
+        /**
+         * All queues and the CSMA state kept for a single neighbor
+         */
+        struct NeighborEntry {
+            inet::MacAddress macAddr;
+            PacketRing lanes[NUM_PRIO_LANES];   // indexed by virtual link ID - LINK_PRIO_CONTROL
+            std::map<int, PacketRing> customLanes; // any other virtual link IDs
+            int totalSize = 0;                  // packets in all lanes above
+            TschCSMA *csma = nullptr;           // created with the first packet enqueued
+            bool hasTxLink = false;             // any TX link to the neighbor in the schedule, see updateBackoffEpoch()
+        };
+
     private:
+        typedef PacketRing* Queue;
+
         /**
-         * Alias for std::list<inet::Packet *>
+         * Neighbor entry and queue selected for the current slot, resolved once in
+         * setVirtualQueue() so that the per-slot accessors don't need any lookups
          */
-        typedef std::list<inet::Packet *>* Queue;
+        struct Selection {
+            NeighborEntry *entry = nullptr;
+            Queue lane = nullptr;
+
+            void clear() { entry = nullptr; lane = nullptr; }
+        };
+
         /**
          * private variable
-         * A list filled with inet::Packet pointers.
+         * Dense table of all neighbors ever enqueued to, entries are never removed,
+         * std::deque keeps references to them stable
          */
-        Queue queue;
+        std::deque<NeighborEntry> neighborTable;
+
         /**
          * private variable
-         * Maps queue to different virtuallinkID/Applications
+         * Maps MAC address (as integer) to the neighbor handle, i.e. index into neighborTable
          */
-        std::map<int, Queue>* virtualQueue;
+        std::unordered_map<uint64_t, int> neighborHandles;
+
         /**
          * private variable
-         * Maps Macaddress to different virtual queues
+         * Total number of packets in all queues
          */
-        std::map<inet::MacAddress, std::map<int, Queue>*> macToQueueMap;
-
+        int totalQueueSize;
         /**
          * private variable
-         * A container of TschCSMA pointer elements to start the Tsch CSMA
+         * Schedule of this interface, tells which neighbors have a TX link
          */
-        std::map<inet::MacAddress,TschCSMA*> backoffTable;
+        TschSlotframe *schedule;
         /**
          * private variable
-         * A inet::MacAddress object used to simplify some functions
+         * Number of shared TX cells to the broadcast address, counts down the backoff
+         * of all neighbors without a TX link of their own
          */
-        inet::MacAddress addr;
+        long broadcastEpoch;
         /**
          * private variable
          * The key  which represents the currently used Neighbor
          */
         inet::MacAddress currentNeighborKey;
+        /**
+         * private variable
+         * Cached entry and queue of the currently used Neighbor and Application
+         */
+        Selection current;
         /**
          * private variable
          * The key  which represents the currently used Application
@@ -247,29 +321,28 @@ class TschNeighbor : public cSimpleModule, protected cListener
          */
         bool getCurrentTschCSMAStatus();
         /**
-         * A public member function to decrement backoff window for all queues directed at destAddr
+         * A public member function to count a shared TX cell directed at @p destAddress,
+         * which decrements the backoff window of all queues it applies to: the queue of
+         * @p destAddress itself and, for broadcast cells, those of all neighbors without a TX link.
          */
-        void updateAllBackoffWindows(inet::MacAddress destAddress, TschSlotframe* sf);
+        void countSharedTxCell(inet::MacAddress destAddress);
         /**
-         * A public member funtion to return a pointer to the macToQueueMap container
-         * @return pointer to the map container macToQueue
+         * Lets the CSMA of @p entry count down against the shared cells to the neighbor
+         * itself if it has a TX link, otherwise against the broadcast ones
          */
-        std::map<inet::MacAddress, std::map<int, std::list<inet::Packet *>*>*>* getMacToQueueMap();
+        void updateBackoffEpoch(NeighborEntry& entry);
         /**
-         * A public member funtion to return a pointer to the backoffTable container
-         * @return pointer to the map container macToQueue
+         * Returns the handle of the neighbor with @p macAddr, i.e. its index in the neighbor table
+         * @param create add a new (empty) entry if the neighbor isn't known yet
+         * @return the handle or -1 if not found and @p create is false
          */
-        std::map<inet::MacAddress,TschCSMA*>* getBackoffTable();
+        int getNeighborHandle(inet::MacAddress macAddr, bool create = false);
         /**
-         * Creates a new list from type inet::Packet*
-         * @return pointer to the new list
+         * Returns the queue for @p virtualLinkId of the given neighbor entry
+         * @param create add a new queue for custom virtual link IDs if missing
+         * @return pointer to the queue or nullptr if not found and @p create is false
          */
-        Queue createQueue();
-        /**
-         * Creates a new map with integer key and list with inet::Packet* as values
-         * @return pointer to this new map
-         */
-        std::map<int, std::list<inet::Packet *>*>* createVirtualQueue();
+        Queue getLane(NeighborEntry& entry, int virtualLinkId, bool create = false);
         /**
          * Prints the values of this neighbor class
          */
@@ -285,17 +358,11 @@ class TschNeighbor : public cSimpleModule, protected cListener
 
         int getVirtualQueueSizeAt(MacAddress macAddress, int virtualLinkId);
 
-        friend std::ostream& operator<<(std::ostream& out, Queue q) {
-            for (auto pkt : *q)
-                out << pkt->getFullName() << endl;
-            return out;
-        }
-
         std::string printPacketQueue(Queue q) {
             std::ostringstream out;
 
-            for (auto pkt : *q)
-                out << pkt->getFullName() << endl;
+            for (int i = 0; i < q->size(); i++)
+                out << q->at(i)->getFullName() << endl;
 
             return out.str();
         }
@@ -305,6 +372,10 @@ class TschNeighbor : public cSimpleModule, protected cListener
         virtual int numInitStages() const override { return NUM_INIT_STAGES; }
         virtual void initialize(int stage) override;
         virtual void handleMessage(cMessage *) override;
+        /**
+         * Keeps the backoff epoch of each neighbor in line with the TX links of the schedule
+         */
+        virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
 };
 }
 #endif /* LINKLAYER_IEEE802154E_TSCHNEIGHBOR_H_ */
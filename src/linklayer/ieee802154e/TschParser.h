@@ -25,46 +25,22 @@
 #define __INET_TschParser_H
 
 #include "inet/common/INETDefs.h"
-#include <array>
+#include "inet/linklayer/common/MacAddress.h"
+#include <functional>
 
 namespace inet{
 /*
  * Parses an xml Tsch_Schedule into Slotframe/Link(s)
  *
+ * Links are not stored but handed over one by one to the caller, so the
+ * memory needed is proportional to the actual schedule and there is no
+ * limit on the number of slotframes or links. The xml document itself is
+ * obtained through cEnvir::getXMLDocument(), which caches it by file name,
+ * i.e. all nodes referring to the same file share a single parsed document.
  */
-
-//class TschParser
-//class INET_API TschParser
 class TschParser
 {
   public:
-    /**
-     * Constructor
-     */
-    TschParser();
-
-    /**
-     * Destructor
-     */
-    virtual ~TschParser();
-
-    /**
-     * Read Tsch xml Schedule file and extract plain text.
-     * ?? return 0 on success, -1 on error
-     */
-    virtual int readTschParmFromXmlFile(const char *filename);
-
-  protected:
-    // Parsing functions
-
-    // Return 1 if beginning of str1 and str2 is equal up to str2-len,
-    // otherwise 0.
-    //
-    int streq(const char *str1, const char *str2);
-
-  public:
-
-    // save extracted Tsch parameter in array of struct ? Or directly into Slotframe/Links class????
     struct Tsch_Link {
       int SlotOffset;
       int channelOffset;
@@ -77,42 +53,47 @@ class TschParser
       bool Type_advertisingOnly;
       int Virtual_id;
       std::string Neighbor_path;
-      std::string Neighbor_address;
-      // ==>  isempty(str):  str.empty()
+      MacAddress Neighbor_address;
     };
 
-    // save extracted Tsch parameter in array of struct ? Or directly into Slotframe/Links class????
-    struct Tsch_Slotframe {
-      int handle;
-      int macSlotframeSize;
-      int numLinks;
-      Tsch_Link links[300];
-    };
-    Tsch_Slotframe Slotframe[300]; // TODO: dynamically allocate?
+    /** Invoked with handle and macSlotframeSize for every slotframe, before its links */
+    typedef std::function<void(int handle, int macSlotframeSize)> SlotframeHandler;
+    /** Invoked for every link of the slotframe last announced */
+    typedef std::function<void(const Tsch_Link &link)> LinkHandler;
 
-  private:
-
-
-  protected:
+    /**
+     * Constructor
+     */
+    TschParser();
 
-    // Extract Slotframe parameters and Links parameters from xml file:
-    // Return value is not fixed yet...
-    int extract_Tsch_param(Tsch_Slotframe &Slotframe, int tsch_token, char *text, int& charpointer);
+    /**
+     * Destructor
+     */
+    virtual ~TschParser();
 
-    // forwinding in text until token is found and returning value of token
-    std::string  find_token(char *text, int& charpointer, std::string);
+    /**
+     * Read Tsch xml Schedule file and pass its slotframes and links to
+     * @p onSlotframe and @p onLink in document order.
+     *
+     * @return number of slotframes read
+     */
+    virtual int readTschParmFromXmlFile(const char *filename, const SlotframeHandler& onSlotframe,
+            const LinkHandler& onLink);
 
-  public:
-    int num_Slotframe;
-    Tsch_Slotframe & get_Tsch_param();
     int get_Tsch_num_Slotframes();
 
+  protected:
+    // Extract Link parameters from a <Link> element into @p link
+    void extractLink(cXMLElement *linkElem, Tsch_Link& link);
 
-//    struct Tsch_Slotframes {
-//    };
+    // Value of boolean attribute @p attr of @p elem, @p defaultValue if absent
+    static bool boolAttr(cXMLElement *elem, const char *attr, bool defaultValue);
 
-//    static int testing_struct(Tsch_Link &link);
+    // Value of integer attribute @p attr of @p elem, @p defaultValue if absent
+    static int intAttr(cXMLElement *elem, const char *attr, int defaultValue);
 
+  private:
+    int num_Slotframe;
 };
 
 } // namespace inet
@@ -0,0 +1,124 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <omnetpp.h>
+
+#include "TschSeqNumTable.h"
+
+namespace tsch {
+
+TschSeqNumTable::TschSeqNumTable(int capacity, int reorderWindow)
+    : highestSeqNum(0)
+    , numHits(0)
+    , numMisses(0)
+    , numEvictions(0)
+    , numReordered(0)
+{
+    configure(capacity, reorderWindow);
+}
+
+void TschSeqNumTable::configure(int capacity, int reorderWindow)
+{
+    if (capacity < 0)
+        throw omnetpp::cRuntimeError("Invalid sequence number table size %d", capacity);
+    if (reorderWindow < 0 || reorderWindow > 64)
+        throw omnetpp::cRuntimeError("Invalid reorder window %d, must be within 0 .. 64", reorderWindow);
+
+    this->capacity = capacity;
+    this->reorderWindow = reorderWindow;
+
+    while (capacity && (int) index.size() > capacity)
+        evict();
+}
+
+TschSeqNumTable::Entry *TschSeqNumTable::find(const Key& key)
+{
+    auto it = index.find(key);
+    if (it == index.end()) {
+        numMisses++;
+        return nullptr;
+    }
+
+    numHits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return &entries.front();
+}
+
+TschSeqNumTable::Entry& TschSeqNumTable::insert(const Key& key, unsigned long seqNum)
+{
+    if (capacity && (int) index.size() >= capacity)
+        evict();
+
+    entries.push_front({key, seqNum, 0});
+    index[key] = entries.begin();
+    return entries.front();
+}
+
+void TschSeqNumTable::evict()
+{
+    index.erase(entries.back().key);
+    entries.pop_back();
+    numEvictions++;
+}
+
+unsigned long TschSeqNumTable::nextSeqNum(const inet::MacAddress& addr, int linkId)
+{
+    Key key = {addr.getInt(), linkId};
+    auto entry = find(key);
+    if (!entry)
+        entry = &insert(key, numEvictions ? highestSeqNum + 1 : 0);
+
+    auto seqNum = entry->seqNum++;
+    highestSeqNum = std::max(highestSeqNum, seqNum);
+    return seqNum;
+}
+
+bool TschSeqNumTable::receive(const inet::MacAddress& addr, int linkId, unsigned long seqNum)
+{
+    Key key = {addr.getInt(), linkId};
+    auto entry = find(key);
+    if (!entry) {
+        insert(key, seqNum + 1);
+        return true;
+    }
+
+    if (seqNum >= entry->seqNum) {
+        // new highest one, the previous highest one moves into the window
+        auto shift = seqNum + 1 - entry->seqNum;
+        entry->received = shift >= 64 ? 0 : entry->received << shift;
+        if (shift <= 64)
+            entry->received |= 1ULL << (shift - 1);
+        entry->seqNum = seqNum + 1;
+        return true;
+    }
+
+    // below the highest one received, i.e. a duplicate unless still missing within the window
+    auto distance = entry->seqNum - 2 - seqNum;    // bit in 'received', wraps around for the highest one
+    if (seqNum + 1 == entry->seqNum || distance >= (unsigned long) reorderWindow
+            || (entry->received & (1ULL << distance)))
+        return false;
+
+    entry->received |= 1ULL << distance;
+    numReordered++;
+    return true;
+}
+
+} // namespace tsch
@@ -0,0 +1,110 @@
+/*
+ * Simulation model for IEEE 802.15.4 Time Slotted Channel Hopping (TSCH)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TSCH_TSCHSEQNUMTABLE_H_
+#define __TSCH_TSCHSEQNUMTABLE_H_
+
+#include <list>
+#include <unordered_map>
+
+#include "inet/linklayer/common/MacAddress.h"
+
+namespace tsch {
+
+/**
+ * @brief MAC sequence numbers per (neighbor, virtual link ID), used to number
+ *        outgoing frames or to detect duplicates among received ones.
+ *
+ * Holds at most a given number of entries (unbounded if 0) and evicts the least
+ * recently used one to make room for a new neighbor / virtual link. Optionally,
+ * frames up to reorderWindow sequence numbers below the highest one received are
+ * accepted once each, instead of dropping every older frame as a duplicate.
+ */
+class TschSeqNumTable
+{
+  public:
+    /**
+     * @param capacity        maximum number of entries, 0 for unbounded
+     * @param reorderWindow   number of out-of-order sequence numbers tracked (0 .. 64)
+     */
+    TschSeqNumTable(int capacity = 0, int reorderWindow = 0);
+
+    /** Changes the limits, evicting entries if needed */
+    void configure(int capacity, int reorderWindow);
+
+    /**
+     * Sender side: returns the sequence number of the next frame to @p addr on
+     * @p linkId. A new entry starts at 0, or, once entries have been evicted,
+     * above any number handed out before, so the receiver doesn't take it for a duplicate.
+     */
+    unsigned long nextSeqNum(const inet::MacAddress& addr, int linkId);
+
+    /**
+     * Receiver side: records @p seqNum received from @p addr on @p linkId
+     * @return false if the frame is a duplicate
+     */
+    bool receive(const inet::MacAddress& addr, int linkId, unsigned long seqNum);
+
+    size_t size() const { return index.size(); }
+    long getNumHits() const { return numHits; }
+    long getNumMisses() const { return numMisses; }
+    long getNumEvictions() const { return numEvictions; }
+    long getNumReordered() const { return numReordered; }
+
+  protected:
+    struct Key {
+        uint64_t addr;
+        int linkId;
+        bool operator==(const Key& other) const { return addr == other.addr && linkId == other.linkId; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return std::hash<uint64_t>()(key.addr * 31 + (unsigned) key.linkId); }
+    };
+    struct Entry {
+        Key key;
+        unsigned long seqNum;   // sender: next one to use, receiver: next one expected
+        uint64_t received;      // receiver: bit i set if seqNum - 2 - i has been received
+    };
+
+    int capacity;
+    int reorderWindow;
+
+    /** All entries, most recently used first */
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    /** Highest sequence number handed out by nextSeqNum() */
+    unsigned long highestSeqNum;
+
+    long numHits;
+    long numMisses;
+    long numEvictions;
+    long numReordered;
+
+    /** Returns the entry of @p key (marked most recently used), or nullptr */
+    Entry *find(const Key& key);
+    /** Adds a new entry for @p key, evicting the least recently used one if full */
+    Entry& insert(const Key& key, unsigned long seqNum);
+    void evict();
+};
+
+} // namespace tsch
+
+#endif
@@ -37,6 +37,7 @@
 #include "TschVirtualLink.h"
 #include "TschSlotframe.h"
 #include "TschParser.h"
+#include "TschBinaryParser.h"
 #include "inet/networklayer/ipv4/RoutingTableParser.h"
 #include "../../common/TschSimsignals.h"
 #include "inet/common/Simsignals.h"
@@ -92,6 +93,18 @@ void TschSlotframe::initialize(int stage)
         cComponent::registerSignal("linkChangedSignal");
         //"TSCH_Schedule_example.xml"
         this->fp = par("fileName").stringValue();
+        this->scheduleIndex = par("scheduleIndex");
+
+        std::string format = par("scheduleFormat").stdstringValue();
+        if (format == "auto") {
+            std::string fileName = fp;
+            binarySchedule = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".tsb") == 0;
+        }
+        else if (format == "xml" || format == "binary")
+            binarySchedule = format == "binary";
+        else
+            throw cRuntimeError("Unknown scheduleFormat '%s'", format.c_str());
+        rebuildSlotTable();
 
         WATCH_PTRVECTOR(links);
     }
@@ -169,17 +182,24 @@ void TschSlotframe::printSlotframe() const
 void TschSlotframe::purge()
 {
     // purge unicast routes
+    bool purged = false;
     for (auto it = links.begin(); it != links.end(); ) {
         TschLink *link = *it;
         if (link->isValid())
             ++it;
         else {
             it = links.erase(it);
+            purged = true;
             ASSERT(link->getSlotframe() == this);    // still filled in, for the listeners' benefit
             emit(linkDeletedSignal, link);
             delete link;
         }
     }
+
+    if (purged) {
+        rebuildSlotTable();
+        rebuildTxLinkCounts();
+    }
 }
 
 TschLink *TschSlotframe::getLink(int k) const
@@ -226,6 +246,17 @@ void TschSlotframe::internalAddLink(TschLink *entry)
     auto pos = upper_bound(links.begin(), links.end(), entry, LinkLessThan(*this));
     links.insert(pos, entry);
     entry->setSlotframe(this);
+    countTxLink(entry, 1);
+
+    // upper_bound() places the entry after all links with the same slot offset,
+    // so appending to the bucket keeps it in the same order as 'links'
+    auto slotOffset = entry->getSlotOffset();
+    if (inSlotTable(slotOffset)) {
+        auto &bucket = slotTable[slotOffset];
+        bucket.push_back(entry);
+        if (bucket.size() == 1)
+            updateNextOccupied();
+    }
 }
 
 
@@ -234,11 +265,70 @@ TschLink *TschSlotframe::internalRemoveLink(TschLink *entry)
     auto i = std::find(links.begin(), links.end(), entry);
     if (i != links.end()) {
         links.erase(i);
+        countTxLink(entry, -1);
+
+        auto slotOffset = entry->getSlotOffset();
+        if (inSlotTable(slotOffset)) {
+            auto &bucket = slotTable[slotOffset];
+            bucket.erase(std::remove(bucket.begin(), bucket.end(), entry), bucket.end());
+            if (bucket.empty())
+                updateNextOccupied();
+        }
         return entry;
     }
     return nullptr;
 }
 
+void TschSlotframe::rebuildSlotTable()
+{
+    slotTable.assign(macSlotframeSize > 0 ? macSlotframeSize : 0, LinkVector());
+
+    for (auto link : links)
+        if (inSlotTable(link->getSlotOffset()))
+            slotTable[link->getSlotOffset()].push_back(link);
+
+    updateNextOccupied();
+}
+
+void TschSlotframe::countTxLink(TschLink *link, int delta)
+{
+    if (!link->isTx())
+        return;
+
+    auto it = txLinkCounts.emplace(link->getAddr().getInt(), 0).first;
+    it->second += delta;
+    if (it->second <= 0)
+        txLinkCounts.erase(it);
+}
+
+void TschSlotframe::rebuildTxLinkCounts()
+{
+    txLinkCounts.clear();
+    for (auto link : links)
+        countTxLink(link, 1);
+}
+
+void TschSlotframe::updateNextOccupied()
+{
+    int size = (int) slotTable.size();
+    nextOccupied.assign(size, -1);
+    occupiedSlots.assign((size + 63) / 64, 0);
+
+    // walk the slotframe backwards twice to account for the wrap-around,
+    // an offset which is the only occupied one is its own successor
+    int next = -1;
+    for (int i = 2 * size - 1; i >= 0; i--) {
+        int offset = i % size;
+        nextOccupied[offset] = next;
+        if (!slotTable[offset].empty())
+            next = offset;
+    }
+
+    for (int offset = 0; offset < size; offset++)
+        if (!slotTable[offset].empty())
+            slotBitmap_set(occupiedSlots, offset);
+}
+
 void TschSlotframe::addLink(TschLink *entry)
 {
     Enter_Method("addLink(...)");
@@ -289,11 +379,16 @@ bool TschSlotframe::deleteLink(TschLink *entry)    //TODO this is almost duplica
 
 void TschSlotframe::linkChanged(TschLink *entry, int fieldCode)
 {
-    if (fieldCode == TschLink::F_CHANOFF) {    // our data structures depend on these fields
-        entry = internalRemoveLink(entry);
-        ASSERT(entry != nullptr);
-        internalAddLink(entry);
+    if (fieldCode == TschLink::F_SLOTOFF) {    // our data structures depend on these fields
+        // the slot index still has the entry under its previous offset, hence re-sort and rebuild
+        auto it = std::find(links.begin(), links.end(), entry);
+        ASSERT(it != links.end());
+        links.erase(it);
+        links.insert(upper_bound(links.begin(), links.end(), entry, LinkLessThan(*this)), entry);
+        rebuildSlotTable();
     }
+    else if (fieldCode == TschLink::F_OPTIONTX || fieldCode == TschLink::F_ADDR)
+        rebuildTxLinkCounts();    // the previous value is gone, can't just move the count
     emit(linkChangedSignal, entry);    // TODO include fieldCode in the notification
 }
 
@@ -324,60 +419,23 @@ bool TschSlotframe::handleOperationStage(LifecycleOperation *operation, IDoneCal
     return true;
 }
 
-/**
- * Returns iterator to the link scheduled for the ASN given
- * or end() if nothing is scheduled.
- */
-std::vector<TschLink *>::iterator TschSlotframe::getLinkFromASNInternal(int64_t asn)
-{
-    for (auto it = links.begin(); it != links.end(); ++it) {
-        if ((*it)->getSlotOffset() == getOffsetFromASN(asn)) {
-            return it;
-            break;
-        }
-        if ((*it)->getSlotOffset() > getOffsetFromASN(asn))
-            break;
-    }
-
-    return links.end();
-}
-
-/**
- * Returns iterator to the link scheduled for the ASN given
- * or end() if nothing is scheduled.
- */
-std::vector<TschLink *>::iterator TschSlotframe::getNextLinkFromASNInternal(int64_t asn)
-{
-    for (auto it = links.begin(); it != links.end(); ++it) {
-        if ((*it)->getSlotOffset() > getOffsetFromASN(asn))
-            return it;
-    }
-
-    return links.begin();
-}
-
 /**
  * Returns the link scheduled for the ASN given
  * or null if nothing is scheduled.
  */
 TschLink *TschSlotframe::getLinkFromASN(int64_t asn)
 {
-    auto it = getLinkFromASNInternal(asn);
-
-    if (it != links.end())
-        return *it;
-    else
-        return nullptr;
+    auto &bucket = getLinksFromASN(asn);
+    return bucket.empty() ? nullptr : bucket.front();
 }
 
-std::vector<TschLink*> TschSlotframe::getLinksFromASN(int64_t asn)
+const TschSlotframe::LinkVector& TschSlotframe::getLinksFromASN(int64_t asn)
 {
-    std::vector<TschLink*> currentLinks = {};
+    auto offset = getOffsetFromASN(asn);
+    if (!inSlotTable(offset))
+        return emptyBucket;
 
-    for (auto it = links.begin(); it != links.end(); ++it) {
-        if ((*it)->getSlotOffset() == getOffsetFromASN(asn))
-            currentLinks.push_back(*it);
-    }
+    auto &currentLinks = slotTable[offset];
 
     if (currentLinks.size() > 1)
         EV_DETAIL << "Found multiple cells sharing slot offset:\n" << currentLinks << endl;
@@ -390,7 +448,11 @@ std::vector<TschLink*> TschSlotframe::getLinksFromASN(int64_t asn)
  */
 TschLink *TschSlotframe::getNextLink(int64_t asn)
 {
-    return *getNextLinkFromASNInternal(asn);
+    auto offset = getOffsetFromASN(asn);
+    if (!inSlotTable(offset) || nextOccupied[offset] < 0)
+        return nullptr;
+
+    return slotTable[nextOccupied[offset]].front();
 }
 
 /**
@@ -399,31 +461,26 @@ TschLink *TschSlotframe::getNextLink(int64_t asn)
  */
 int64_t TschSlotframe::getASNofNextLink(int64_t asn)
 {
-    auto l = getNextLink(asn);
+    int offset = getOffsetFromASN(asn);
+    if (!inSlotTable(offset) || nextOccupied[offset] < 0)
+        return -1; // should never happen, there's at least a minimal cell
 
-    // we had a wrap around within the slotframe
-    if (l->getSlotOffset() < getOffsetFromASN(asn)) {
-        return asn + l->getSlotOffset() + (macSlotframeSize - getOffsetFromASN(asn));
-    }
-
-    // exactly one slotframe later
-    else if (l->getSlotOffset() == getOffsetFromASN(asn)) {
-        return asn + macSlotframeSize;
-    }
+    int next = nextOccupied[offset];
 
     // after current slotOffset but no wrap-around
-    else if (l->getSlotOffset() > getOffsetFromASN(asn)) {
-        return asn + (l->getSlotOffset() - getOffsetFromASN(asn));
-    }
+    if (next > offset)
+        return asn + (next - offset);
 
-    return -1; // should never happen
+    // we had a wrap around within the slotframe, or exactly one slotframe later
+    return asn + next + (macSlotframeSize - offset);
 }
 
 bool TschSlotframe::removeLinkAtCell(cellLocation_t cell, uint64_t neighborId) {
     for (auto it = links.begin(); it != links.end(); ++it)
         if ( (*it)->getSlotOffset() == cell.timeOffset && (*it)->getChannelOffset() == cell.channelOffset && (*it)->getAddr().getInt() == neighborId )
         {
-            links.erase(it);
+            auto link = internalRemoveLink(*it);
+            emit(linkDeletedSignal, link);
             return true;
         }
 
@@ -431,12 +488,7 @@ bool TschSlotframe::removeLinkAtCell(cellLocation_t cell, uint64_t neighborId) {
 }
 
 bool TschSlotframe::hasLink(inet::MacAddress macAddress) {
-
-    auto f = [ &macAddress ](TschLink* link) -> bool {
-        return link->isTx() && link->getAddr() == macAddress;
-    };
-
-    return std::find_if(links.begin(), links.end(), f) != links.end();
+    return txLinkCounts.find(macAddress.getInt()) != txLinkCounts.end();
 }
 
 std::vector<TschLink*> TschSlotframe::allTxLinks(inet::MacAddress macAddress) {
@@ -536,6 +588,7 @@ bool TschSlotframe::removeAutoLinkToNeighbor(inet::MacAddress neigbhorMac) {
         if (l->getAddr() == neigbhorMac && l->isAuto() && l->isTx())
         {
             internalRemoveLink(l);
+            emit(linkDeletedSignal, l);
             return true;
         }
 
@@ -544,61 +597,44 @@ bool TschSlotframe::removeAutoLinkToNeighbor(inet::MacAddress neigbhorMac) {
 
 
 void TschSlotframe::xmlSchedule(){
-    inet::TschParser tp;
-    //TODO: Can this not be just a void function?
-    tp.readTschParmFromXmlFile(this->fp);
-
-    for (int num_Slotframe=0; num_Slotframe < tp.get_Tsch_num_Slotframes(); num_Slotframe++){
-        this->setMacSlotframeSize(tp.Slotframe[num_Slotframe].macSlotframeSize);
-        this->setMacSlotframeHandle(tp.Slotframe[num_Slotframe].handle);
-
-//        auto sf = new TschSlotframe();
-//               sf->setMacSlotframeSize(tp.Slotframe[num_Slotframe].macSlotframeSize);
-//               sf->setHandle(tp.Slotframe[num_Slotframe].handle);
-
-        for (int n=0; n < tp.Slotframe[num_Slotframe].numLinks; n++){
-            inet::MacAddress macAddr;
-            if((tp.Slotframe[num_Slotframe].links[n].Virtual_id != -2) && (tp.Slotframe[num_Slotframe].links[n].Virtual_id != 0 )){
-                auto l = this->createVirtualLink();
-                l->setSlotOffset(tp.Slotframe[num_Slotframe].links[n].SlotOffset);
-                l->setChannelOffset(tp.Slotframe[num_Slotframe].links[n].channelOffset);
-                l->setTx(tp.Slotframe[num_Slotframe].links[n].Option_tx);
-                l->setRx(tp.Slotframe[num_Slotframe].links[n].Option_rx);
-                l->setShared(tp.Slotframe[num_Slotframe].links[n].Option_shared);
-                l->setTimekeeping(tp.Slotframe[num_Slotframe].links[n].Option_timekeeping);
-                l->setNormal(tp.Slotframe[num_Slotframe].links[n].Type_normal);
-                l->setAdv(tp.Slotframe[num_Slotframe].links[n].Type_advertising);
-                l->setAdvOnly(tp.Slotframe[num_Slotframe].links[n].Type_advertisingOnly);
-                l->setVirtualLink(tp.Slotframe[num_Slotframe].links[n].Virtual_id);
-                l->setXml(true);
-                //l->???(tp.Slotframe[num_Slotframe].links[n].Neighbor_path); // setter not implemented
-                //std::cout << tp.Slotframe[num_Slotframe].links[n].Neighbor_address << endl;
-                macAddr.setAddress(tp.Slotframe[num_Slotframe].links[n].Neighbor_address.c_str());
-                l->setAddr(macAddr);
-                // Add link to actual Slotframe
-                this->addLink(l);
-            }else if((tp.Slotframe[num_Slotframe].links[n].Virtual_id == -2) || (tp.Slotframe[num_Slotframe].links[n].Virtual_id == 0 )){
-                auto l = this->createLink();
-                l->setSlotOffset(tp.Slotframe[num_Slotframe].links[n].SlotOffset);
-                l->setChannelOffset(tp.Slotframe[num_Slotframe].links[n].channelOffset);
-                l->setTx(tp.Slotframe[num_Slotframe].links[n].Option_tx);
-                l->setRx(tp.Slotframe[num_Slotframe].links[n].Option_rx);
-                l->setShared(tp.Slotframe[num_Slotframe].links[n].Option_shared);
-                l->setTimekeeping(tp.Slotframe[num_Slotframe].links[n].Option_timekeeping);
-                l->setNormal(tp.Slotframe[num_Slotframe].links[n].Type_normal);
-                l->setAdv(tp.Slotframe[num_Slotframe].links[n].Type_advertising);
-                l->setAdvOnly(tp.Slotframe[num_Slotframe].links[n].Type_advertisingOnly);
-                l->setXml(true);
-                //l->???(tp.Slotframe[num_Slotframe].links[n].Neighbor_path); // setter not implemented
-                // TODO: In some random way Neighbor_address is incomplete. Still searching for reason
-                //std::cout <<"This Type is:  " <<  typeid(tp.Slotframe[num_Slotframe].links[n].Neighbor_address).name() << endl;
-                //std::cout << tp.Slotframe[num_Slotframe].links[n].Neighbor_address << endl;
-                macAddr.setAddress(tp.Slotframe[num_Slotframe].links[n].Neighbor_address.c_str());
-                l->setAddr(macAddr);
-                // Add link to actual Slotframe
-                this->addLink(l);
-            }
+    auto onSlotframe = [this](int handle, int macSlotframeSize) {
+        this->setMacSlotframeSize(macSlotframeSize);
+        this->setMacSlotframeHandle(handle);
+    };
+
+    auto onLink = [this](const inet::TschParser::Tsch_Link& link) {
+        TschLink *l;
+        if ((link.Virtual_id != -2) && (link.Virtual_id != 0)) {
+            auto vl = this->createVirtualLink();
+            vl->setVirtualLink(link.Virtual_id);
+            l = vl;
         }
+        else
+            l = this->createLink();
+
+        l->setSlotOffset(link.SlotOffset);
+        l->setChannelOffset(link.channelOffset);
+        l->setTx(link.Option_tx);
+        l->setRx(link.Option_rx);
+        l->setShared(link.Option_shared);
+        l->setTimekeeping(link.Option_timekeeping);
+        l->setNormal(link.Type_normal);
+        l->setAdv(link.Type_advertising);
+        l->setAdvOnly(link.Type_advertisingOnly);
+        l->setXml(true);
+        //l->???(link.Neighbor_path); // setter not implemented
+        l->setAddr(link.Neighbor_address);
+        // Add link to actual Slotframe
+        this->addLink(l);
+    };
+
+    if (binarySchedule) {
+        inet::TschBinaryParser bp;
+        bp.readSchedule(this->fp, scheduleIndex, onSlotframe, onLink);
+    }
+    else {
+        inet::TschParser tp;
+        tp.readTschParmFromXmlFile(this->fp, onSlotframe, onLink);
     }
 }
 
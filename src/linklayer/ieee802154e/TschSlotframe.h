@@ -26,6 +26,7 @@
 #ifndef __TSCH_TSCHSLOTFRAME_H
 #define __TSCH_TSCHSLOTFRAME_H
 
+#include <unordered_map>
 #include <vector>
 
 #include <omnetpp.h>
@@ -55,7 +56,20 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
     // to modify the vectors storing links, but they can not access them directly.
     LinkVector links;
 
+    // Index over 'links' for per-slot lookups: slotTable[o] holds the links at
+    // slot offset o (in the same order as in 'links'), nextOccupied[o] is the
+    // closest slot offset after o (wrapping around) holding at least one link, -1 if none
+    std::vector<LinkVector> slotTable;
+    std::vector<int> nextOccupied;
+    slotBitmap_t occupiedSlots; // slot offsets with a non-empty slotTable entry
+    const LinkVector emptyBucket;
+
+    // Number of TX links per neighbor (MAC address as integer), answers hasLink()
+    std::unordered_map<uint64_t, int> txLinkCounts;
+
     const char* fp;
+    bool binarySchedule;    // 'fp' is a compiled schedule file rather than xml
+    int scheduleIndex;      // which schedule of a compiled schedule file to load
 
   protected:
 
@@ -84,6 +98,23 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
 
     //TschVirtualLink *internalRemoveLink(TschVirtualLink *entry);
 
+    /**
+     * Rebuilds the slot offset index from scratch, needed whenever
+     * the slotframe size or the slot offset of a link changes.
+     */
+    void rebuildSlotTable();
+
+    /** Recomputes the next occupied slot offset for each offset of the slotframe */
+    void updateNextOccupied();
+
+    /** Adds @p delta to the TX link count of the neighbor of @p link, if it is a TX link */
+    void countTxLink(TschLink *link, int delta);
+
+    /** Recounts the TX links per neighbor, needed whenever the TX option or address of a link changes */
+    void rebuildTxLinkCounts();
+
+    inline bool inSlotTable(int slotOffset) const { return slotOffset >= 0 && slotOffset < (int) slotTable.size(); }
+
   public:
     TschSlotframe() {}
     virtual ~TschSlotframe();
@@ -105,14 +136,6 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
 
     inline int getOffsetFromASN(int64_t asn) { return asn % macSlotframeSize; };
 
-    /**
-     * Returns iterator to the link scheduled for the ASN given
-     * or end() if nothing is scheduled.
-     */
-    std::vector<TschLink *>::iterator getLinkFromASNInternal(int64_t asn);
-
-    std::vector<TschLink *>::iterator getNextLinkFromASNInternal(int64_t asn);
-
   public:
     /**
      * For debugging
@@ -126,6 +149,9 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
 
     virtual LinkVector getLinks() const { return links; }
 
+    /** Slot offsets (within the slotframe) holding at least one link */
+    const slotBitmap_t& getOccupiedSlots() const { return occupiedSlots; }
+
     TschLink* getLinkByCellCoordinates(offset_t slotOf, offset_t chOf, MacAddress neighborAddr);
 
     /**
@@ -195,6 +221,7 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
 
     void setMacSlotframeSize(int macSlotframeSize) {
         this->macSlotframeSize = macSlotframeSize;
+        rebuildSlotTable();
     }
 
     /**
@@ -203,7 +230,11 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
      */
     TschLink *getLinkFromASN(int64_t asn);
 
-    std::vector<TschLink*> getLinksFromASN(int64_t asn);
+    /**
+     * Returns all links scheduled for the ASN given (empty if none).
+     * The reference stays valid until the schedule is modified.
+     */
+    const LinkVector& getLinksFromASN(int64_t asn);
 
     /**
      * Get the next scheduled link considering the given ASN.
@@ -224,7 +255,7 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
     bool removeLinkAtCell(cellLocation_t cell, uint64_t neighborId);
 
     /**
-     * Checks if there is a link scheduled for the given Macaddress
+     * Checks if there is a TX link scheduled for the given Macaddress
      * True if found
      * False if not found
      */
@@ -240,6 +271,7 @@ class TschSlotframe : public cSimpleModule, protected cListener, public ILifecyc
 
     bool removeAutoLinkToNeighbor(inet::MacAddress neigbhorMac);
 
+    /** Loads the preconfigured schedule from 'fileName', either xml or compiled (binary) */
     void xmlSchedule();
 
   private:
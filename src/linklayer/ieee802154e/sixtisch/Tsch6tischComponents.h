@@ -247,6 +247,46 @@ inline std::ostream& operator<<(std::ostream& out, const Tsch6pSFIDs sfid) {
     return out << s;
 }
 
+/**
+ * Types of per-cell statistics events reported by the MAC to the Scheduling Function
+ */
+typedef enum TschCellStatTypes
+{
+    CELLSTAT_TXFRAMES = 0,
+    CELLSTAT_MISSEDACKS,
+    CELLSTAT_RECVDACKS,
+    CELLSTAT_RXFRAMES,
+    CELLSTAT_TXACKS,
+    CELLSTAT_DUPLICATES,
+    CELLSTAT_SLOT
+} tschCellStatType_t;
+
+inline std::ostream& operator<<(std::ostream& out, const TschCellStatTypes statType) {
+    const char* s = 0;
+    switch(statType) {
+        PRINT_ENUM(CELLSTAT_TXFRAMES, s);
+        PRINT_ENUM(CELLSTAT_MISSEDACKS, s);
+        PRINT_ENUM(CELLSTAT_RECVDACKS, s);
+        PRINT_ENUM(CELLSTAT_RXFRAMES, s);
+        PRINT_ENUM(CELLSTAT_TXACKS, s);
+        PRINT_ENUM(CELLSTAT_DUPLICATES, s);
+        PRINT_ENUM(CELLSTAT_SLOT, s);
+    }
+    return out << s;
+}
+
+/**
+ * Single per-cell statistics event, i.e. something happened
+ * at the cell (slotOffset, channelOffset) with neighborId during ASN asn
+ */
+typedef struct TschCellStat {
+    tschCellStatType_t statType;
+    offset_t slotOffset;
+    offset_t channelOffset;
+    uint64_t neighborId;
+    int64_t asn;
+} tschCellStat_t;
+
 typedef std::vector<std::tuple<cellLocation_t, uint8_t>> cellVector;
 typedef std::vector<cellLocation_t> cellListVector;
 
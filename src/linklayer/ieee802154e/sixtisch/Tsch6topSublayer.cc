@@ -47,6 +47,7 @@
 #include "SixpDataChunk_m.h"
 #include "SixpHeaderChunk_m.h"
 #include "../../../common/VirtualLinkTag_m.h"
+#include "../../../common/TrafficClassTag_m.h"
 #include "inet/common/packet/chunk/BytesChunk.h"
 #include "../Ieee802154eMacHeader_m.h"
 #include "inet/common/ProtocolGroup.h"
@@ -1104,6 +1105,7 @@ Packet* Tsch6topSublayer::createAddRequest(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(b(addDelRelocReqMsgHdrSz + cellListSz + (sizeof(simtime_t)*8)));
 
     auto pkt = new Packet("6top ADD Req");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP | TC_SIXP_REQUEST);
     piggybackOnMessage(pkt, destId);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
@@ -1143,6 +1145,7 @@ Packet* Tsch6topSublayer::createDeleteRequest(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(b(addDelRelocReqMsgHdrSz + cellListSz + (sizeof(simtime_t)*8)));
 
     auto pkt = new Packet("6top DEL Req");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP | TC_SIXP_REQUEST);
     piggybackOnMessage(pkt, destId);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
@@ -1186,6 +1189,7 @@ Packet* Tsch6topSublayer::createRelocationRequest(uint64_t destId, uint8_t seqNu
     sixpData->setChunkLength(b(addDelRelocReqMsgHdrSz + cellListSz + (sizeof(simtime_t)*8)));
 
     auto pkt = new Packet("6top RELOCATE Req");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP | TC_SIXP_REQUEST);
     piggybackOnMessage(pkt, destId);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
@@ -1214,6 +1218,7 @@ Packet* Tsch6topSublayer::createClearRequest(uint64_t destId, uint8_t seqNum) {
     sixpData->setChunkLength(b(baseMsgHdrSz + 16));
 
     auto pkt = new Packet("6top CLEAR Req");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP | TC_SIXP_REQUEST);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
 
@@ -1242,6 +1247,7 @@ Packet* Tsch6topSublayer::createSignalRequest(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(B(payloadSz + sizeof(simtime_t)));
 
     auto pkt = new Packet("6top SIGNAL Req");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP | TC_SIXP_REQUEST);
 
     const auto& payloadCast = static_cast<uint8_t *>(payload);
 
@@ -1280,6 +1286,7 @@ Packet* Tsch6topSublayer::createSuccessResponse(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(b(cellListSz + sizeof(simtime_t)*8));
 
     auto pkt = new Packet("6top SUCCESS Resp");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP);
     piggybackOnMessage(pkt, destId);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
@@ -1314,6 +1321,7 @@ Packet* Tsch6topSublayer::createErrorResponse(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(B(sizeof(simtime_t)));
 
     auto pkt = new Packet("6top ERROR Resp");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
 
@@ -1341,6 +1349,7 @@ Packet* Tsch6topSublayer::createSeqNumErrorResponse(uint64_t destId, uint8_t seq
     sixpData->setChunkLength(B(sizeof(simtime_t)));
 
     auto pkt = new Packet("6top SEQ ERROR Resp");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
 
@@ -1375,6 +1384,7 @@ Packet* Tsch6topSublayer::createClearResponse(uint64_t destId, uint8_t seqNum,
     sixpData->setChunkLength(B(sizeof(simtime_t)));
 
     auto pkt = new Packet("6top CLEAR Resp");
+    pkt->addTag<TrafficClassTag>()->setTrafficClass(TC_SIXP);
     pkt->insertAtBack(sixpData);
     pkt->insertAtFront(sixpHeader);
 
@@ -172,16 +172,61 @@ int TschLinkInfo::addCell(uint64_t nodeId, cellLocation_t cell, uint8_t linkOpti
 
     std::tuple<cellLocation_t, uint8_t> cellTuple = std::make_tuple(cell, linkOption);
     linkInfo[nodeId].scheduledCells.push_back(cellTuple);
+    indexCell(nodeId, cell, linkOption);
 
     return 0;
 }
 
 bool TschLinkInfo::isCellAlreadyScheduled(offset_t slotOffset, uint64_t neighborId) {
-    for (auto link : linkInfo[neighborId].scheduledCells)
-        if (std::get<0>(link).timeOffset == slotOffset)
-            return true;
+    if (slotOffset >= slotOwners.size())
+        return false;
 
-    return false;
+    auto& owners = slotOwners[slotOffset];
+    return std::find(owners.begin(), owners.end(), neighborId) != owners.end();
+}
+
+void TschLinkInfo::indexCell(uint64_t nodeId, const cellLocation_t &cell, uint8_t linkOption) {
+    cellOwners[cellKey(cell)].push_back(std::make_pair(nodeId, linkOption));
+
+    if (cell.timeOffset >= slotOwners.size())
+        slotOwners.resize(cell.timeOffset + 1);
+    slotOwners[cell.timeOffset].push_back(nodeId);
+    slotBitmap_set(occupiedSlots, cell.timeOffset);
+
+    auto info = linkInfo.find(nodeId);
+    if (info != linkInfo.end() && getCellOptions_isTX(linkOption)) {
+        info->second.numTxCells++;
+        if (!getCellOptions_isAUTO(linkOption) && !getCellOptions_isSHARED(linkOption))
+            info->second.numDedicatedTxCells++;
+    }
+}
+
+void TschLinkInfo::unindexCell(uint64_t nodeId, const cellLocation_t &cell, uint8_t linkOption) {
+    auto it = cellOwners.find(cellKey(cell));
+    if (it != cellOwners.end()) {
+        auto& owners = it->second;
+        auto owner = std::find(owners.begin(), owners.end(), std::make_pair(nodeId, linkOption));
+        if (owner != owners.end())
+            owners.erase(owner);
+        if (owners.empty())
+            cellOwners.erase(it);
+    }
+
+    if (cell.timeOffset < slotOwners.size()) {
+        auto& owners = slotOwners[cell.timeOffset];
+        auto owner = std::find(owners.begin(), owners.end(), nodeId);
+        if (owner != owners.end())
+            owners.erase(owner);
+        if (owners.empty())
+            slotBitmap_clear(occupiedSlots, cell.timeOffset);
+    }
+
+    auto info = linkInfo.find(nodeId);
+    if (info != linkInfo.end() && getCellOptions_isTX(linkOption)) {
+        info->second.numTxCells--;
+        if (!getCellOptions_isAUTO(linkOption) && !getCellOptions_isSHARED(linkOption))
+            info->second.numDedicatedTxCells--;
+    }
 }
 
 int TschLinkInfo::addCells(uint64_t nodeId, const std::vector<cellLocation_t> &cellList, uint8_t linkOption)
@@ -304,6 +349,16 @@ std::vector<cellLocation_t> TschLinkInfo::getDedicatedCells(uint64_t nodeId, boo
     return res;
 }
 
+int TschLinkInfo::getNumTxCells(uint64_t nodeId) {
+    auto info = linkInfo.find(nodeId);
+    return info != linkInfo.end() ? info->second.numTxCells : 0;
+}
+
+int TschLinkInfo::getNumDedicatedTxCells(uint64_t nodeId) {
+    auto info = linkInfo.find(nodeId);
+    return info != linkInfo.end() ? info->second.numDedicatedTxCells : 0;
+}
+
 std::vector<cellLocation_t> TschLinkInfo::getCellsByType(uint64_t nodeId, uint8_t requiredCellType) {
     std::vector<cellLocation_t> res = {};
 
@@ -327,13 +382,11 @@ uint8_t TschLinkInfo::getCellOptions(uint64_t nodeId, cellLocation_t candidate)
         return 0xFF;
     }
 
-    auto it = std::find_if(linkInfo[nodeId].scheduledCells.begin(), linkInfo[nodeId].scheduledCells.end(),
-                           [candidate](const std::tuple<cellLocation_t, uint8_t> & t) -> bool {
-                             return std::get<0>(t) == candidate; });
-
-    if (it != linkInfo[nodeId].scheduledCells.end()) {
-        return std::get<1>(*it);
-    }
+    auto it = cellOwners.find(cellKey(candidate));
+    if (it != cellOwners.end())
+        for (auto& owner : it->second)
+            if (owner.first == nodeId)
+                return owner.second;
 
     return 0xFF;
 }
@@ -350,20 +403,17 @@ int TschLinkInfo::getNumCells(uint64_t nodeId) {
 }
 
 uint64_t TschLinkInfo::getNodeOfCell(cellLocation_t candidate) {
-    /* loop through all links */
-    for (auto & info: linkInfo) {
+    auto it = cellOwners.find(cellKey(candidate));
+    if (it == cellOwners.end())
+        return 0;
 
-        auto it = std::find_if(info.second.scheduledCells.begin(), info.second.scheduledCells.end(),
-               [candidate](const std::tuple<cellLocation_t, uint8_t> & t) -> bool {
-                 return std::get<0>(t) == candidate && !getCellOptions_isSHARED(std::get<1>(t));
-            }
-        );
+    /* lowest nodeId first, same as iterating linkInfo */
+    uint64_t nodeId = 0;
+    for (auto& owner : it->second)
+        if (!getCellOptions_isSHARED(owner.second) && (!nodeId || owner.first < nodeId))
+            nodeId = owner.first;
 
-        if (it != info.second.scheduledCells.end())
-            return info.first;
-    }
-
-    return 0;
+    return nodeId;
 }
 
 
@@ -380,8 +430,12 @@ void TschLinkInfo::clearCells(uint64_t nodeId) {
 
     linkInfo[nodeId].scheduledCells.erase(
         std::remove_if( linkInfo[nodeId].scheduledCells.begin(), linkInfo[nodeId].scheduledCells.end(),
-            [] (decltype(linkInfo[nodeId].scheduledCells)::value_type link) -> bool {
-                return !getCellOptions_isAUTO(std::get<1>(link));
+            [this, nodeId] (decltype(linkInfo[nodeId].scheduledCells)::value_type link) -> bool {
+                if (getCellOptions_isAUTO(std::get<1>(link)))
+                    return false;
+
+                unindexCell(nodeId, std::get<0>(link), std::get<1>(link));
+                return true;
             }
         ),
         linkInfo[nodeId].scheduledCells.end()
@@ -415,8 +469,10 @@ void TschLinkInfo::deleteCells(uint64_t nodeId, const std::vector<cellLocation_t
             return std::get<0>(link) == *it;
         });
 
-        if (elem != scheduledCells->end())
+        if (elem != scheduledCells->end()) {
+            unindexCell(nodeId, std::get<0>(*elem), std::get<1>(*elem));
             scheduledCells->erase(elem);
+        }
         else
             EV_WARN << "Instructed to delete cell at " << *it << ", but it doesn't exist" << endl;
     }
@@ -439,19 +495,7 @@ std::vector<uint64_t> TschLinkInfo::getNeighbors()
 bool TschLinkInfo::timeOffsetScheduled(offset_t timeOffset) {
     Enter_Method_Silent();
 
-    /* loop through all links */
-    for(auto & info: linkInfo) {
-        auto it = std::find_if(info.second.scheduledCells.begin(), info.second.scheduledCells.end(),
-          [timeOffset] (const std::tuple<cellLocation_t, uint8_t> & t) -> bool {
-            return std::get<0>(t).timeOffset == timeOffset;
-        });
-
-        if (it != info.second.scheduledCells.end()) {
-            return true;
-        }
-    }
-
-    return false;
+    return slotBitmap_test(occupiedSlots, timeOffset);
 }
 
 bool TschLinkInfo::cellsInSchedule(uint64_t nodeId, std::vector<cellLocation_t> &cellList, uint8_t linkOption)
@@ -464,11 +508,11 @@ bool TschLinkInfo::cellsInSchedule(uint64_t nodeId, std::vector<cellLocation_t>
         return false;
 
     inSchedule = true;
-    cellVector scheduled = linkInfo[nodeId].scheduledCells;
-//    std::vector<cellLocation_t>::iterator it;
+    auto owner = std::make_pair(nodeId, linkOption);
     for (auto it = cellList.begin(); it != cellList.end() && inSchedule; ++it) {
-        auto currCell = std::make_tuple(*it, linkOption);
-        inSchedule = std::find(scheduled.begin(), scheduled.end(), currCell) != scheduled.end();
+        auto owners = cellOwners.find(cellKey(*it));
+        inSchedule = owners != cellOwners.end()
+                && std::find(owners->second.begin(), owners->second.end(), owner) != owners->second.end();
     }
 
     return inSchedule;
@@ -529,8 +573,13 @@ int TschLinkInfo::relocateCells(uint64_t nodeId, std::vector<cellLocation_t> &ne
 
     /* remove the first n cells that were nominated for relocation */
     for (int i = 0; i < (int) newCells.size(); ++i) {
-        linkInfo[nodeId].scheduledCells.erase(std::find(
-                linkInfo[nodeId].scheduledCells.begin(), linkInfo[nodeId].scheduledCells.end(), relocationCells[i]));
+        auto elem = std::find(linkInfo[nodeId].scheduledCells.begin(), linkInfo[nodeId].scheduledCells.end(),
+                relocationCells[i]);
+        if (elem == linkInfo[nodeId].scheduledCells.end())
+            continue;
+
+        unindexCell(nodeId, std::get<0>(*elem), std::get<1>(*elem));
+        linkInfo[nodeId].scheduledCells.erase(elem);
     }
 
 //    EV_DETAIL << "scheduledCells after erasing " << newCells.size() << " relocationCells: " << scheduledCells << endl;
@@ -26,6 +26,7 @@
 
 #include <omnetpp.h>
 #include <algorithm>
+#include <unordered_map>
 #include "WaicCellComponents.h"
 #include "Tsch6tischComponents.h"
 #include "tschLinkInfoTimeoutMsg_m.h"
@@ -58,6 +59,9 @@ class TschLinkInfo: public cSimpleModule
         cellVector relocationCells;   /**< Cells that this node requested relocate.
                                            Is only non-empty during a RELOCATE
                                            transaction started by this node. */
+        int numTxCells;               /**< Number of TX cells in scheduledCells */
+        int numDedicatedTxCells;      /**< Number of TX cells in scheduledCells
+                                           that are neither shared nor auto */
         //std::mutex nliMutex;        /**< Prevents SF & 6P from read/editing this entry
         //                                 at the same time */
 
@@ -178,6 +182,16 @@ public:
     std::vector<cellLocation_t> getDedicatedCells(uint64_t nodeId) { return getDedicatedCells(nodeId, false); };
     std::vector<cellLocation_t> getCellsByType(uint64_t nodeId, uint8_t requiredCellType);
 
+    /**
+     * @brief Count the TX cells scheduled with @p nodeId without building a cell list,
+     *        constant time as the counters are kept up to date on every cell add / removal.
+     *
+     * @return number of TX cells (getNumTxCells) or dedicated TX cells
+     *         (getNumDedicatedTxCells, same as getDedicatedCells(nodeId).size())
+     */
+    int getNumTxCells(uint64_t nodeId);
+    int getNumDedicatedTxCells(uint64_t nodeId);
+
     /**
      * @return the associated cell options or 0xFF
      */
@@ -215,6 +229,9 @@ public:
      */
     bool timeOffsetScheduled(offset_t timeOffset);
 
+    /** @return    slot offsets of all cells scheduled with any neighbor */
+    const slotBitmap_t& getOccupiedSlots() const { return occupiedSlots; }
+
     /**
      * @brief Check if all cells in @p cellList are scheduled on the link with
      *        @p nodeId, and with a matching @p linkOption.
@@ -362,6 +379,28 @@ private:
                                       offset_t timeOffset);
 
     bool isCellAlreadyScheduled(offset_t slotOffset, uint64_t neighborId);
+
+    /**
+     * Secondary indexes over all 'scheduledCells', kept in sync by
+     * indexCell() / unindexCell() whenever a cell is added or removed.
+     *
+     * cellOwners:  cell location (see cellKey()) -> (nodeId, linkOption) of every
+     *              link that has this cell scheduled
+     * slotOwners:  slot offset -> nodeId of every cell scheduled at this slot offset
+     * occupiedSlots: slot offsets with a non-empty slotOwners entry
+     *
+     * The per-node TX cell counters in NodeLinkInfo_t are updated here as well.
+     */
+    std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, uint8_t>>> cellOwners;
+    std::vector<std::vector<uint64_t>> slotOwners;
+    slotBitmap_t occupiedSlots;
+
+    static uint64_t cellKey(const cellLocation_t &cell) {
+        return ((uint64_t) cell.timeOffset << 32) | cell.channelOffset;
+    }
+
+    void indexCell(uint64_t nodeId, const cellLocation_t &cell, uint8_t linkOption);
+    void unindexCell(uint64_t nodeId, const cellLocation_t &cell, uint8_t linkOption);
 };
 
 #endif /*__WAIC_TSCHLINKINFO_H_*/
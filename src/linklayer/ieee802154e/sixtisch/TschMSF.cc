@@ -25,6 +25,7 @@
 #include "Tsch6tischComponents.h"
 #include "../Ieee802154eMac.h"
 #include "../TschVirtualLink.h"
+#include "../../../common/TrafficClassTag_m.h"
 #include "inet/physicallayer/contract/packetlevel/SignalTag_m.h"
 #include <omnetpp.h>
 #include <random>
@@ -57,6 +58,7 @@ TschMSF::TschMSF() :
     pCheckScheduleConsistency(false),
     isLeafNode(true),
     numCellsRequired(-1),
+    slotframeStatsMsg(nullptr),
     numTranAbandonedMaxRetries(0),
     initCellOverride({0, 0}),
     neighbors({}),
@@ -64,6 +66,7 @@ TschMSF::TschMSF() :
 {
 }
 TschMSF::~TschMSF() {
+    cancelAndDelete(slotframeStatsMsg);
 }
 
 void TschMSF::initialize(int stage) {
@@ -92,6 +95,10 @@ void TschMSF::initialize(int stage) {
         pChOfEnd = par("chOfEnd").intValue();
         pInitNumRx = par("initNumRx").intValue();
 
+        slotframeStatsMsg = new cMessage("MAX_NUM_CELLS", REACHED_MAXNUMCELLS);
+        // evaluate the closing slotframe before the MAC starts the next one
+        slotframeStatsMsg->setSchedulingPriority(-1);
+
         queueUtilization = registerSignal("queueUtilization");
         failed6pAdd = registerSignal("failed6pAdd");
         uplinkScheduledSignal = registerSignal("uplinkScheduled");
@@ -111,10 +118,10 @@ void TschMSF::initialize(int stage) {
         interfaceModule = dynamic_cast<InterfaceTable *>(getParentModule()->getParentModule()->getParentModule()->getParentModule()->getSubmodule("interfaceTable", 0));
         pNodeId = interfaceModule->getInterface(1)->getMacAddress().getInt();
         pSlotframeLength = getModuleByPath("^.^.schedule")->par("macSlotframeSize").intValue();
+        cellStatChannels = pNumChannels;
+        cellStatistic.resize(pSlotframeLength * cellStatChannels, {0, 0, 0});
         pTsch6p = (Tsch6topSublayer*) getParentModule()->getSubmodule("sixtop");
         mac = check_and_cast<Ieee802154eMac*>(getModuleByPath("^.^.mac"));
-        mac->subscribe(POST_MODEL_CHANGE, this);
-        mac->subscribe(mac->pktRecFromUpperSignal, this);
         mac->subscribe(mac->pktRecFromLowerSignal, this);
         mac->subscribe("burstFinishedProcessing", this);
 
@@ -163,8 +170,8 @@ void TschMSF::initialize(int stage) {
         WATCH(num6pAddFailed);
         WATCH(pLimNumCellsUsedLow);
         WATCH(pLimNumCellsUsedHigh);
-        WATCH_PTRMAP(nbrStatistic);
-        WATCH_MAP(cellStatistic);
+        WATCH_VECTOR(nbrStatistic);
+        WATCH_VECTOR(cellStatistic);
         WATCH(numCellsRequired);
         WATCH(numTranAbandonedMaxRetries);
         WATCH(numTranAbortedUnknownReason);
@@ -366,31 +373,32 @@ std::string TschMSF::printCellUsage(std::string neighborMac, double usage) {
 //    std::cout << pNodeId << usageInfo << endl;
 }
 
-bool TschMSF::slOfScheduled(offset_t slOf) {
-    auto links = schedule->getLinks();
-    for (auto l : links)
-        if (slOf == l->getSlotOffset())
-            return true;
-    return false;
+void TschMSF::handleSlotframeStats() {
+    // evaluation only triggers 6P transactions, it doesn't touch the counters of other neighbors
+    for (auto handle : maxNumCellsReached) {
+        nbrStatistic[handle].maxNumCellsReached = false;
+        handleMaxCellsReached(nbrStatistic[handle]);
+    }
+
+    maxNumCellsReached.clear();
 }
 
-void TschMSF::handleMaxCellsReached(cMessage* msg) {
-    auto neighborMac = (MacAddress*) msg->getContextPointer();
-    auto nbrId = neighborMac->getInt();
+void TschMSF::handleMaxCellsReached(NbrStatistic &stat) {
+    auto nbrId = stat.macAddr;
 
-    // we might get a notification from our own mac
-    if (nbrId == pNodeId)
+    // we might get a notification from our own mac, nothing to assess if the counters were reset meanwhile
+    if (nbrId == pNodeId || stat.numCellsElapsed == 0)
         return;
 
-    EV_DETAIL << "MAX_NUM_CELLS reached, assessing cell usage with " << *neighborMac
-            << ", currently scheduled TX cells: " << pTschLinkInfo->getDedicatedCells(nbrId) << endl;
+    EV_DETAIL << "MAX_NUM_CELLS reached, assessing cell usage with " << MacAddress(nbrId)
+            << ", currently scheduled TX cells: " << pTschLinkInfo->getNumDedicatedTxCells(nbrId) << endl;
 
-    auto usage = (double) nbrStatistic[nbrId]->numCellsUsed / nbrStatistic[nbrId]->numCellsElapsed;
+    auto usage = (double) stat.numCellsUsed / stat.numCellsElapsed;
 
     if (nbrId == rplParentId)
         uplinkCellUtil = usage;
 
-    EV_DETAIL << printCellUsage(neighborMac->str(), usage) << endl;
+    EV_DETAIL << printCellUsage(MacAddress(nbrId).str(), usage) << endl;
 
     // Avoid attempts to schedule more cells if the lossy-link imitation has started
 //    if (usage >= pLimNumCellsUsedHigh && !isLossyLink()) -- NOT NEEDED anymore, as only UDP packets can be dropped
@@ -408,8 +416,8 @@ void TschMSF::handleMaxCellsReached(cMessage* msg) {
         deleteCells(nbrId, 1);
 
     // reset values
-    nbrStatistic[nbrId]->numCellsUsed = 0; //intrand(pMaxNumCells >> 1);
-    nbrStatistic[nbrId]->numCellsElapsed = 0;
+    stat.numCellsUsed = 0; //intrand(pMaxNumCells >> 1);
+    stat.numCellsElapsed = 0;
 }
 
 bool TschMSF::isLossyLink() {
@@ -466,15 +474,9 @@ void TschMSF::handleHousekeeping(cMessage* msg) {
         auto dedicatedCells = pTschLinkInfo->getDedicatedCells(neighbourId);
         EV << "Dedicated cells: " << dedicatedCells << endl;
         for (auto cell : dedicatedCells) {
-            auto it = cellStatistic.find(cell);
-            if (it == cellStatistic.end())
-            {
-                EV << "cell stat entry not found" << endl;
-                cellStatistic.insert({cell, {0, 0, 0}});
-                continue;
-            }
+            auto index = cellStatIndex(cell);
 
-            auto cellStat = std::get<1>(*it);
+            auto cellStat = cellStatistic[index];
 
             EV << "sent: " << (int) cellStat.NumTx << ", acked: " << (int) cellStat.NumTxAck << endl;
 
@@ -684,7 +686,7 @@ void TschMSF::handleSelfMessage(cMessage* msg) {
             break;
         }
         case REACHED_MAXNUMCELLS: {
-            handleMaxCellsReached(msg);
+            handleSlotframeStats();
             return;
         }
         case DO_START: {
@@ -955,9 +957,7 @@ void TschMSF::removeAutoTxCell(uint64_t nodeId) {
     pTschLinkInfo->deleteCells(nodeId, sharedCells, MAC_LINKOPTIONS_TX | MAC_LINKOPTIONS_SHARED | MAC_LINKOPTIONS_SRCAUTO);
     pTsch6p->schedule->removeAutoLinkToNeighbor(MacAddress(nodeId));
 
-    auto cellStat = cellStatistic.find(sharedCells.back());
-    if (cellStat != cellStatistic.end())
-        cellStatistic.erase(cellStat);
+    clearCellStat(sharedCells.back());
 }
 
 tsch6pSFID_t TschMSF::getSFID() {
@@ -1017,29 +1017,34 @@ std::vector<cellLocation_t> TschMSF::pickConsecutively(std::vector<cellLocation_
     return picked;
 }
 
-bool TschMSF::slotOffsetAvailable(offset_t slOf) {
-    return !pTschLinkInfo->timeOffsetScheduled(slOf)
-            && slOf != autoRxCell.timeOffset
-            && !slotOffsetReserved(slOf)
-            && !slOfScheduled(slOf);
-}
+slotBitmap_t TschMSF::getOccupiedSlots() {
+    slotBitmap_t occupied = pTschLinkInfo->getOccupiedSlots();
+    slotBitmap_merge(occupied, schedule->getOccupiedSlots());
+    slotBitmap_set(occupied, autoRxCell.timeOffset);
 
-std::vector<offset_t> TschMSF::getAvailableSlotsInRange(int start, int end) {
-    std::vector<offset_t> slots = {};
+    for (auto const& reserved : reservedTimeOffsets)
+        for (auto slOf : reserved.second)
+            slotBitmap_set(occupied, slOf);
 
+    return occupied;
+}
+
+std::vector<offset_t> TschMSF::getAvailableSlotsInRange(const slotBitmap_t &occupied, int start, int end) {
     if (start < 0 || end < 0) {
         EV_WARN << "Requested slot offsets in invalid range";
-        return slots;
+        return {};
     }
 
-    for (int slOf = start; slOf < end; slOf++)
-        if (slotOffsetAvailable( (offset_t) slOf))
-            slots.push_back((offset_t) slOf);
+    auto slots = slotBitmap_unset(occupied, start, end);
 
     EV_DETAIL << "\nIn range (" << start << ", " << end << ") found available slot offsets: " << slots << endl;
     return slots;
 }
 
+std::vector<offset_t> TschMSF::getAvailableSlotsInRange(int start, int end) {
+    return getAvailableSlotsInRange(getOccupiedSlots(), start, end);
+}
+
 std::vector<offset_t> TschMSF::getAvailableSlotsInRange(int slOffsetEnd) {
     return getAvailableSlotsInRange(0, slOffsetEnd);
 }
@@ -1090,6 +1095,7 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
         return -EINVAL;
     }
 
+    auto occupied = getOccupiedSlots();
     std::vector<offset_t> freeSlots = {}; // generally unoccupied slot offsets
     std::vector<offset_t> blacklisted = {}; // slot offsets previously rejected by the receiver node
     std::vector<offset_t> availableSlots = {}; // from which the CELL_LIST will be filled, subject to extra filtering (blacklisting) from freeSlots
@@ -1117,13 +1123,13 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
                 endOffset = pSlotframeLength;
             }
 
-            freeSlots = getAvailableSlotsInRange(startOffset, endOffset);
+            freeSlots = getAvailableSlotsInRange(occupied, startOffset, endOffset);
         }
         else
         {
             auto llStartOffset = par("lowLatencyStartingOffset").intValue();
 
-            freeSlots = getAvailableSlotsInRange(llStartOffset > 0 ? llStartOffset : 0, pSlotframeLength);
+            freeSlots = getAvailableSlotsInRange(occupied, llStartOffset > 0 ? llStartOffset : 0, pSlotframeLength);
 
             // Doesn't make sense to only focus on daisy-chains inside a slotframe??
 
@@ -1135,7 +1141,7 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
         }
     }
     else
-        freeSlots = getAvailableSlotsInRange(pSlotframeLength);
+        freeSlots = getAvailableSlotsInRange(occupied, 0, pSlotframeLength);
 
     /** If slot blacklisting is enabled, avoid including previously rejected slot offsets in a new request */
     if (blacklistedSlots.find(destId) != blacklistedSlots.end())
@@ -1143,8 +1149,12 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
 
     if (!blacklisted.empty())
     {
+        slotBitmap_t blacklistedBitmap;
+        for (auto slot : blacklisted)
+            slotBitmap_set(blacklistedBitmap, slot);
+
         for (auto slot : freeSlots)
-            if (!std::count(blacklisted.begin(), blacklisted.end(), slot))
+            if (!slotBitmap_test(blacklistedBitmap, slot))
                 availableSlots.push_back(slot);
 
         EV_DETAIL << "Available slots after filtering blacklisted ones: " << availableSlots << endl;
@@ -1169,7 +1179,7 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
 
         for (auto gap : unmatchedRanges)
         {
-            gapSlots = getAvailableSlotsInRange(get<0>(gap), get<1>(gap));
+            gapSlots = getAvailableSlotsInRange(occupied, get<0>(gap), get<1>(gap));
 
             if (gapSlots.size()) {
                 EV << "Found " << gapSlots.size() << " available slots in " << gap << endl;
@@ -1180,7 +1190,7 @@ int TschMSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellLi
 
                 // no free slots detected in the last gap, try to wrap into the next slotframe
                 if (get<1>(gap) == pSlotframeLength)
-                    gapSlots = getAvailableSlotsInRange(get<0>(unmatchedRanges[0]), get<1>(unmatchedRanges[0]));
+                    gapSlots = getAvailableSlotsInRange(occupied, get<0>(unmatchedRanges[0]), get<1>(unmatchedRanges[0]));
             }
         }
 
@@ -1261,10 +1271,11 @@ int TschMSF::pickCells(uint64_t destId, std::vector<cellLocation_t> &cellList,
     EV_DETAIL << "Picking cells from list: " << cellList << endl;
 
     std::vector<cellLocation_t> pickedCells = {};
+    auto occupied = getOccupiedSlots();
 
     for (auto cell : cellList) {
         EV_DETAIL << "proposed cell " << cell;
-        if (slotOffsetAvailable(cell.timeOffset))
+        if (!slotBitmap_test(occupied, cell.timeOffset))
         {
             EV_DETAIL << " available" << endl;
             /* cell is still available, pick it. */
@@ -1298,11 +1309,8 @@ int TschMSF::pickCells(uint64_t destId, std::vector<cellLocation_t> &cellList,
 }
 
 void TschMSF::clearCellStats(std::vector<cellLocation_t> cellList) {
-    for (auto &cell : cellList) {
-        auto cand = cellStatistic.find(cell);
-        if (cand != cellStatistic.end())
-            cellStatistic.erase(cand);
-    }
+    for (auto &cell : cellList)
+        clearCellStat(cell);
 }
 
 bool TschMSF::checkOverlapping() {
@@ -1515,10 +1523,7 @@ void TschMSF::handleSuccessRelocate(uint64_t sender, std::vector<cellLocation_t>
         EV_WARN << "Seems RELOCATE failed, worth retrying?" << endl;
     else {
         EV_DETAIL << cellList << " are successfully relocated" << endl;
-        auto cellStat = cellStatistic.find(cellList.back());
-
-        if (cellStat != cellStatistic.end())
-            cellStatistic.erase(cellStat);
+        clearCellStat(cellList.back());
     }
 }
 
@@ -1538,18 +1543,7 @@ void TschMSF::clearScheduleWithNode(uint64_t neighborId)
     } else
         delete ctrlMsg;
 
-    if (nbrStatistic.find(neighborId) != nbrStatistic.end()) {
-        nbrStatistic[neighborId]->numCellsElapsed = 0;
-        nbrStatistic[neighborId]->numCellsUsed = 0;
-        // TODO: cancel the scheduled MAX_NUM_CELLS selfmsg
-//        cancelEvent(nbrStatistic[neighborId]->maxNumCellsMsg);
-
-//        if (maxNumCellsMessages[neighborId]) {
-//            cancelEvent(maxNumCellsMessages[neighborId]);
-//            EV_DETAIL << "Cancelled MAX_NUM_CELLS message to " << MacAddress(neighborId);
-//        }
-
-    }
+    resetNbrStatistic(neighborId);
 }
 
 void TschMSF::freeReservedCellsWith(uint64_t nodeId) {
@@ -1757,7 +1751,7 @@ bool TschMSF::slotOffsetReserved(offset_t slOf) {
 }
 
 bool TschMSF::slotOffsetReserved(uint64_t nodeId, offset_t slOf) {
-    std::vector<offset_t> slOffsets = reservedTimeOffsets[nodeId];
+    auto const& slOffsets = reservedTimeOffsets[nodeId];
     return std::find(slOffsets.begin(), slOffsets.end(), slOf) != slOffsets.end();
 }
 
@@ -1801,13 +1795,15 @@ void TschMSF::handleParentChangedSignal(uint64_t newParentId) {
 }
 
 void TschMSF::handlePacketEnqueued(uint64_t dest) {
-    if (MacAddress(dest) == MacAddress::BROADCAST_ADDRESS)
+    Enter_Method_Silent();
+
+    if (!hasStarted || MacAddress(dest) == MacAddress::BROADCAST_ADDRESS)
         return;
 
-    auto txCells = pTschLinkInfo->getCellsByType(dest, MAC_LINKOPTIONS_TX);
+    auto numTxCells = pTschLinkInfo->getNumTxCells(dest);
 
     EV_DETAIL << "Received MAC notification for a packet addressed to "
-            << MacAddress(dest) << ", TX cells: " << txCells << endl;
+            << MacAddress(dest) << ", TX cells: " << numTxCells << endl;
 
     if (pCheckScheduleConsistency)
         checkScheduleConsistency(dest);
@@ -1819,9 +1815,7 @@ void TschMSF::handlePacketEnqueued(uint64_t dest) {
 //        if (!par("scheduleUplinkOnJoin").boolValue() && isLeafNode && rplRank == 2)
 //            return;
 
-        auto dedicatedCells = pTschLinkInfo->getDedicatedCells(dest);
-
-        if (!dedicatedCells.size() && !pTschLinkInfo->inTransaction(dest)) {
+        if (!pTschLinkInfo->getNumDedicatedTxCells(dest) && !pTschLinkInfo->inTransaction(dest)) {
             EV_DETAIL << "No dedicated TX cell found to this node, and "
                     << "we are currently not in transaction with it, attempting to add one TX cell" << endl;
             addCells(dest, 1, MAC_LINKOPTIONS_TX);
@@ -1829,7 +1823,7 @@ void TschMSF::handlePacketEnqueued(uint64_t dest) {
     }
 
     // Ensure minimal connectivity
-    if (!txCells.size())
+    if (!numTxCells)
         scheduleAutoCell(dest);
 
     if (pInitNumRx > 0)
@@ -1909,10 +1903,7 @@ void TschMSF::handleDeleteCellsSync(std::vector<int> slofsToDelete, uint64_t nbr
 
     pTschLinkInfo->deleteCells(neighborId, deletable, linkOption);
 
-    if (nbrStatistic.find(neighborId) != nbrStatistic.end()) {
-        nbrStatistic[neighborId]->numCellsElapsed = 0;
-        nbrStatistic[neighborId]->numCellsUsed = 0;
-    }
+    resetNbrStatistic(neighborId);
 
     EV << "Deleted " << (int) slofsToDelete.size() << " cells synchronously" << endl;
 }
@@ -1953,46 +1944,14 @@ void TschMSF::receiveSignal(cComponent *src, simsignal_t id, cObject *value, cOb
     if (id == packetSentSignal)
         udpPacketsSent++;
 
-    std::string signalName = getSignalName(id);
-
-    static std::vector<std::string> namesNeigh = {}; //{"nbSlot-neigh-", "nbTxFrames-neigh-", "nbRxFrames-neigh-"};
-    static std::vector<std::string> namesLink = {"nbSlot-link-", "nbTxFrames-link-", "nbRecvdAcks-link-"};
-
-    // this is a hint we should check for new dynamic signals
-    if (dynamic_cast<cPostParameterChangeNotification *>(value)) {
-        // consider all neighbors we already know
-        for (auto const& neigbhor : neighbors) {
-            // subscribe to all neighbor-related signals
-            auto macStr = MacAddress(neigbhor).str();
-            for (auto & name: namesNeigh) {
-                auto fullname = name + macStr;
-                if (src->isSubscribed(fullname.c_str(), this) == false)
-                    src->subscribe(fullname.c_str(), this);
-            }
-
-            // subscribe to all link related signals
-            for (auto & cell :pTschLinkInfo->getCells(neigbhor)) {
-                auto slotOffset = std::get<0>(cell).timeOffset;
-                auto channelOffset = std::get<0>(cell).channelOffset;
-
-                for (auto & name: namesLink) {
-                    std::stringstream fullname;
-                    fullname << name << "0." << slotOffset << "." << channelOffset;
-                    if (src->isSubscribed(fullname.str().c_str(), this) == false)
-                        src->subscribe(fullname.str().c_str(), this);
-                }
-            }
-        }
-    }
-
     if (id == linkBrokenSignal && par("lowLatencyMode").boolValue() && uplinkSlotOffset > 0)
     {
         Packet *datagram = check_and_cast<Packet *>(value);
-        std::string packetName(datagram->getFullName());
-        EV_DETAIL << "MSF received link break for " << packetName << endl;
+        EV_DETAIL << "MSF received link break for " << datagram->getFullName() << endl;
 
         // FIXME: checks also if the lost 6P message was really addressed to the parent
-        if (packetName.find("6top") != std::string::npos && packetName.find("Req") != std::string::npos) {
+        auto trafficClassTag = datagram->findTag<TrafficClassTag>();
+        if (trafficClassTag && (trafficClassTag->getTrafficClass() & TC_SIXP_REQUEST)) {
             auto uplinkCells = pTschLinkInfo->getDedicatedCells(rplParentId);
 
             if ((int) uplinkCells.size() > 0)
@@ -2083,11 +2042,7 @@ void TschMSF::handleBurstFinishedProcessingSignal()
 
     // Reset usage stats to avoid adding a cell after the service rate is restored to the initial value
 
-    if (nbrStatistic.find(rplParentId) != nbrStatistic.end())
-    {
-        nbrStatistic[rplParentId]->numCellsElapsed = 0;
-        nbrStatistic[rplParentId]->numCellsUsed = 0;
-    }
+    resetNbrStatistic(rplParentId);
 
 
 }
@@ -2112,11 +2067,7 @@ void TschMSF::receiveSignal(cComponent *src, simsignal_t id, long value, cObject
     if (std::strcmp(signalName.c_str(), "burstArrived") == 0) {
         EV << "MSF received signal that burst arrived, resetting cells elapsed and usage stats" << endl;
 
-        if (nbrStatistic.find(rplParentId) != nbrStatistic.end())
-        {
-            nbrStatistic[rplParentId]->numCellsElapsed = 0;
-            nbrStatistic[rplParentId]->numCellsUsed = 0;
-        }
+        resetNbrStatistic(rplParentId);
 
         auto currentTxCells = pTschLinkInfo->getDedicatedCells(rplParentId);
         auto numCellsToDelete = (int) currentTxCells.size() - par("initialNumCells").intValue();
@@ -2185,12 +2136,6 @@ void TschMSF::receiveSignal(cComponent *src, simsignal_t id, long value, cObject
         return;
     }
 
-    if (id == mac->pktRecFromUpperSignal) {
-        auto macCtrlInfo = (Ieee802154eMac::MacGenericInfo*) details;
-        handlePacketEnqueued(macCtrlInfo->getNodeId());
-        return;
-    }
-
     if (id == mac->pktRecFromLowerSignal) {
         if (find(neighbors.begin(), neighbors.end(), value) == neighbors.end())
         {
@@ -2243,129 +2188,164 @@ void TschMSF::receiveSignal(cComponent *src, simsignal_t id, long value, cObject
         uplinkSlotOffset = (uint8_t) value;
         return;
     }
+}
 
-    std::string statisticStr;
-    std::string scopeStr;
+void TschMSF::handleCellStat(const tschCellStat_t &stat)
+{
+    // only elapsed slots, transmissions and ACKs on dedicated TX cells are accounted for
+    if (!hasStarted || (stat.statType != CELLSTAT_SLOT && stat.statType != CELLSTAT_TXFRAMES
+            && stat.statType != CELLSTAT_RECVDACKS))
+        return;
 
-    auto pos = signalName.find('-'), pos2 = pos;
+    Enter_Method_Silent();
 
-    if (pos != std::string::npos) {
-        statisticStr = signalName.substr(0, pos);
+    cellLocation_t cell = {stat.slotOffset, stat.channelOffset};
 
-        pos2 = signalName.find('-', pos + 1);
-        if (pos2 != std::string::npos)
-            scopeStr = signalName.substr(pos+1, pos2-pos-1);
-        else
-            return; //error
-    } else
-        return; //error
+    auto neighbor = pTschLinkInfo->getNodeOfCell(cell);
 
-    if (scopeStr != "link")
+    // TODO: find a different solution for overlapping dedicated and shared cell
+    if (neighbor == 0)
         return;
 
-    std::string linkStr = signalName.substr(pos2+1, signalName.size());
-    pos = linkStr.find('.');
-    pos2 = linkStr.find('.', pos + 1);
-    offset_t slotOffset = std::stoi(linkStr.substr(pos + 1, pos2-pos-1));
-    offset_t channelOffset = std::stoi(linkStr.substr(pos2 + 1, linkStr.size()-pos-1));
-    cellLocation_t cell = {slotOffset, channelOffset};
-
-    auto neighbor = pTschLinkInfo->getNodeOfCell(cell);
     auto options = pTschLinkInfo->getCellOptions(neighbor, cell);
 
     EV << "Found neighbor " << MacAddress(neighbor) << " of cell " << cell << endl;
 
-    if (neighbor == 0) {
-        return; // TODO: find a different solution for overlapping dedicated and shared cell
-        std::ostringstream out;
-
-        out << "could not find neighbor for cell " << linkStr << endl;
-        throw cRuntimeError(out.str().c_str());
-    }
-
     if (options != 0xFF && getCellOptions_isTX(options) && !getCellOptions_isSHARED(options) && neighbor != MacAddress::BROADCAST_ADDRESS.getInt())
     {
-        updateNeighborStats(neighbor, statisticStr);
-        updateCellTxStats(cell, statisticStr);
+        updateNeighborStats(getNbrStatHandle(neighbor), stat.statType);
+        updateCellTxStats(cell, stat.statType);
+    }
+}
+
+int TschMSF::cellStatIndex(const cellLocation_t &cell) {
+    if ((int) cell.channelOffset >= cellStatChannels) {
+        // e.g. cells of a manual schedule, widen the rows to the channel offsets actually used
+        int channels = cell.channelOffset + 1;
+        int rows = cellStatChannels ? cellStatistic.size() / cellStatChannels : 0;
+        std::vector<CellStatistic> widened(rows * channels, {0, 0, 0});
+        for (int i = 0; i < rows * cellStatChannels; i++)
+            widened[i / cellStatChannels * channels + i % cellStatChannels] = cellStatistic[i];
+        cellStatistic.swap(widened);
+        cellStatChannels = channels;
     }
 
+    int index = cell.timeOffset * cellStatChannels + cell.channelOffset;
+    if (index >= (int) cellStatistic.size())
+        cellStatistic.resize((cell.timeOffset + 1) * cellStatChannels, {0, 0, 0});
+
+    return index;
 }
 
-void TschMSF::updateCellTxStats(cellLocation_t cell, std::string statType) {
-    if (cellStatistic.find(cell) == cellStatistic.end())
-        cellStatistic.insert({cell, {0, 0, 0}});
+void TschMSF::clearCellStat(const cellLocation_t &cell) {
+    auto index = cellStatIndex(cell);
+    cellStatistic[index] = {0, 0, 0};
+}
 
-    if (statType == "nbTxFrames") {
-        cellStatistic[cell].NumTx++;
-        if (cellStatistic[cell].NumTx >= pMaxNumTx) {
-            cellStatistic[cell].NumTx =  cellStatistic[cell].NumTx / 2;
-            cellStatistic[cell].NumTxAck = cellStatistic[cell].NumTxAck / 2;
+void TschMSF::updateCellTxStats(cellLocation_t cell, tschCellStatType_t statType) {
+    auto index = cellStatIndex(cell);
+    auto& cellStat = cellStatistic[index];
+
+    if (statType == CELLSTAT_TXFRAMES) {
+        cellStat.NumTx++;
+        if (cellStat.NumTx >= pMaxNumTx) {
+            cellStat.NumTx =  cellStat.NumTx / 2;
+            cellStat.NumTxAck = cellStat.NumTxAck / 2;
         }
-    } else if (statType == "nbRecvdAcks")
-        cellStatistic[cell].NumTxAck++;
+    } else if (statType == CELLSTAT_RECVDACKS)
+        cellStat.NumTxAck++;
+}
+
+int TschMSF::getNbrStatHandle(uint64_t neighborId) {
+    auto it = nbrStatHandles.find(neighborId);
+    if (it != nbrStatHandles.end())
+        return it->second;
+
+    nbrStatistic.push_back(NbrStatistic(neighborId));
+    nbrStatHandles[neighborId] = (int) nbrStatistic.size() - 1;
+    return (int) nbrStatistic.size() - 1;
+}
+
+void TschMSF::resetNbrStatistic(uint64_t neighborId) {
+    auto it = nbrStatHandles.find(neighborId);
+    if (it == nbrStatHandles.end())
+        return;
+
+    auto& stat = nbrStatistic[it->second];
+    stat.numCellsElapsed = 0;
+    stat.numCellsUsed = 0;
+
+    // drop the neighbor from the pending MAX_NUM_CELLS evaluation, its counters start over
+    if (stat.maxNumCellsReached) {
+        stat.maxNumCellsReached = false;
+        maxNumCellsReached.erase(std::remove(maxNumCellsReached.begin(), maxNumCellsReached.end(), it->second),
+                maxNumCellsReached.end());
+    }
 }
 
 void TschMSF::incrementNeighborCellElapsed(uint64_t neighborId) {
     Enter_Method_Silent();
-    if (nbrStatistic.find(neighborId) == nbrStatistic.end())
-        nbrStatistic.insert({neighborId, new NbrStatistic(neighborId)});
+    auto handle = getNbrStatHandle(neighborId);
+
+    nbrStatistic[handle].numCellsElapsed++;
+    checkMaxCellsReachedFor(handle);
+}
+
+void TschMSF::incrementNeighborCellsElapsed(uint64_t neighborId, int numCells) {
+    Enter_Method_Silent();
+    if (numCells <= 0)
+        return;
 
-    nbrStatistic[neighborId]->numCellsElapsed++;
-    checkMaxCellsReachedFor(neighborId);
+    auto handle = getNbrStatHandle(neighborId);
+
+    // counter is only 8 bits wide, MAX_NUM_CELLS evaluation resets it anyway
+    auto elapsed = (int) nbrStatistic[handle].numCellsElapsed + numCells;
+    nbrStatistic[handle].numCellsElapsed = (uint8_t) std::min(elapsed, 255);
+    checkMaxCellsReachedFor(handle);
 }
 
 void TschMSF::decrementNeighborCellElapsed(uint64_t neighborId) {
-    if (nbrStatistic.find(neighborId) == nbrStatistic.end()) {
-//        nbrStatistic.insert({neighborId, new NbrStatistic(neighborId)});
+    auto it = nbrStatHandles.find(neighborId);
+    if (it == nbrStatHandles.end())
         return;
-    }
 
-    nbrStatistic[neighborId]->numCellsElapsed--;
+    nbrStatistic[it->second].numCellsElapsed--;
 }
 
-void TschMSF::checkMaxCellsReachedFor(uint64_t neighborId) {
-    Enter_Method_Silent();
+void TschMSF::checkMaxCellsReachedFor(int handle) {
+    auto& stat = nbrStatistic[handle];
 
-    if (nbrStatistic[neighborId]->numCellsElapsed >= pMaxNumCells)
-    {
-        EV_DETAIL << "Reached MAX_NUM_CELLS with " << MacAddress(neighborId) << endl;
-        if (maxNumCellsMessages.find(neighborId) == maxNumCellsMessages.end()) {
-            auto maxNumCellMsg = new cMessage("MAX_NUM_CELLS", REACHED_MAXNUMCELLS);
-            maxNumCellMsg->setContextPointer(new MacAddress(neighborId));
-            maxNumCellsMessages[neighborId] = maxNumCellMsg;
-        }
+    if (stat.numCellsElapsed < pMaxNumCells || stat.maxNumCellsReached)
+        return;
 
-//        if (maxNumCellsMessages[neighborId] && maxNumCellsMessages[neighborId]->isScheduled()) {
-//            EV_DETAIL << "MAX_NUM_CELLS message already scheduled, aborting and re-scheduling a new one" << endl;
-//            cancelEvent(maxNumCellsMessages[neighborId]);
-//        }
+    EV_DETAIL << "Reached MAX_NUM_CELLS with " << MacAddress(stat.macAddr) << endl;
 
+    stat.maxNumCellsReached = true;
+    maxNumCellsReached.push_back(handle);
 
-        if (maxNumCellsMessages[neighborId] && !maxNumCellsMessages[neighborId]->isScheduled())
-            // little extra delay necessary to allow cellsUsed counter increment before cell utilization is evaluated
-            scheduleAt(simTime() + 0.005, maxNumCellsMessages[neighborId]);
-    }
+    // evaluated once the slotframe is over, so that all cells used in it are accounted for
+    if (!slotframeStatsMsg->isScheduled())
+        scheduleAt(mac->getNextSlotframeStart(pSlotframeLength), slotframeStatsMsg);
 }
 
-void TschMSF::updateNeighborStats(uint64_t neighborId, std::string statType) {
-    if (nbrStatistic.find(neighborId) == nbrStatistic.end())
-        nbrStatistic.insert({neighborId, new NbrStatistic(neighborId)});
+void TschMSF::updateNeighborStats(int handle, tschCellStatType_t statType) {
+    auto& stat = nbrStatistic[handle];
 
-    if (statType == "nbSlot") {
-        nbrStatistic[neighborId]->numCellsElapsed++;
-        EV_DETAIL << "NumCellsElapsed for " << MacAddress(neighborId) << " now at " << +(nbrStatistic[neighborId]->numCellsElapsed) << endl;
-    } else if (statType == "nbTxFrames") {
-        nbrStatistic[neighborId]->numCellsUsed++;
+    if (statType == CELLSTAT_SLOT) {
+        stat.numCellsElapsed++;
+        EV_DETAIL << "NumCellsElapsed for " << MacAddress(stat.macAddr) << " now at " << +(stat.numCellsElapsed) << endl;
+    } else if (statType == CELLSTAT_TXFRAMES) {
+        stat.numCellsUsed++;
 
         // If stats are reset while there's a transmission, the elapsed counter is 0, while used is incremented to 1
-        if (!nbrStatistic[neighborId]->numCellsElapsed)
-            nbrStatistic[neighborId]->numCellsElapsed = nbrStatistic[neighborId]->numCellsUsed;
+        if (!stat.numCellsElapsed)
+            stat.numCellsElapsed = stat.numCellsUsed;
 
-        EV_DETAIL << "NumCellsUsed for " << MacAddress(neighborId) << " now at " << +(nbrStatistic[neighborId]->numCellsUsed) << endl;
-        EV_DETAIL << "NumCellsElapsed for " << MacAddress(neighborId) << " now at " << +(nbrStatistic[neighborId]->numCellsElapsed) << endl;
+        EV_DETAIL << "NumCellsUsed for " << MacAddress(stat.macAddr) << " now at " << +(stat.numCellsUsed) << endl;
+        EV_DETAIL << "NumCellsElapsed for " << MacAddress(stat.macAddr) << " now at " << +(stat.numCellsElapsed) << endl;
     }
 
-    checkMaxCellsReachedFor(neighborId);
+    checkMaxCellsReachedFor(handle);
 }
 
 uint32_t TschMSF::saxHash(int maxReturnVal, InterfaceToken EUI64addr)
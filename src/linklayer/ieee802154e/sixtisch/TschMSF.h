@@ -23,6 +23,7 @@
 #define __WAIC_TSCHMSF_H_
 
 #include <omnetpp.h>
+#include <unordered_map>
 
 #include "Tsch6topSublayer.h"
 #include "../TschHopping.h"
@@ -107,11 +108,13 @@ class TschMSF: public TschSF, public cListener {
             uint8_t numCellsElapsed;
             uint8_t numCellsUsed;
             uint64_t macAddr;
+            bool maxNumCellsReached; // queued for evaluation at the next slotframe boundary
 //            cMessage* maxNumCellsMsg;
 
             NbrStatistic() {
                 this->numCellsElapsed = 0;
                 this->numCellsUsed = 0;
+                this->maxNumCellsReached = false;
 //                this->maxNumCellsMsg = new cMessage("MAX_NUM_CELLS", REACHED_MAXNUMCELLS);
 //                maxNumCellsMsg->setContextPointer(new MacAddress(neighborId));
             }
@@ -121,6 +124,7 @@ class TschMSF: public TschSF, public cListener {
                 this->numCellsElapsed = 0;
                 this->numCellsUsed = 0;
                 this->macAddr = nodeId;
+                this->maxNumCellsReached = false;
             }
 
 
@@ -287,11 +291,15 @@ class TschMSF: public TschSF, public cListener {
 
     virtual void incrementNeighborCellElapsed(uint64_t neighborId) override;
     virtual void decrementNeighborCellElapsed(uint64_t neighborId) override;
+    virtual void incrementNeighborCellsElapsed(uint64_t neighborId, int numCells) override;
 
     void handleMessage(cMessage* msg) override;
     void handleDoStart(cMessage* msg);
     void handleHousekeeping(cMessage* msg);
-    void virtual handleMaxCellsReached(cMessage* msg);
+    void virtual handleMaxCellsReached(NbrStatistic &stat);
+
+    /** Evaluate MAX_NUM_CELLS for all neighbors that reached it during the last slotframe */
+    void handleSlotframeStats();
 
     /* unimplemented on purpose */
     void recordPDR(cMessage* msg) override {}
@@ -300,6 +308,9 @@ class TschMSF: public TschSF, public cListener {
     void receiveSignal(cComponent *src, simsignal_t id, long value, cObject *details) override;
     void receiveSignal(cComponent *src, simsignal_t id, const char *s, cObject *details) override;
 
+    /** Accounts for elapsed / used dedicated TX cells, replaces the former per-cell signals */
+    void handleCellStat(const tschCellStat_t &stat) override;
+
     /**
      * Process RPL preferred parent updates
      *
@@ -316,7 +327,7 @@ class TschMSF: public TschSF, public cListener {
      *
      * @param destId MAC address of the destination for which there's a packet enqueued
      */
-    virtual void handlePacketEnqueued(uint64_t destId);
+    virtual void handlePacketEnqueued(uint64_t destId) override;
 
     // get list of cells with preferred parent to delete synchronously
     std::vector<cellLocation_t> getCellsToDeleteSync(uint64_t nodeId, int numCellsReq);
@@ -394,11 +405,21 @@ class TschMSF: public TschSF, public cListener {
      */
     std::map<uint64_t, std::vector<offset_t>> reservedTimeOffsets;
 
-    std::map<uint64_t, NbrStatistic*> nbrStatistic;
-    std::map<uint64_t, cMessage*> maxNumCellsMessages;
+    /**
+     * Cell usage statistics, kept in flat arrays. Neighbors get a handle (index
+     * into nbrStatistic) on first use, cells are indexed by cellStatIndex().
+     * Per-slot accounting only increments counters, neighbors reaching MAX_NUM_CELLS
+     * are queued in maxNumCellsReached and evaluated in one pass at the next
+     * slotframe boundary, when slotframeStatsMsg fires.
+     */
+    std::unordered_map<uint64_t, int> nbrStatHandles;
+    std::vector<NbrStatistic> nbrStatistic;
+    std::vector<int> maxNumCellsReached;
+    cMessage *slotframeStatsMsg;
+    std::vector<CellStatistic> cellStatistic;
+    int cellStatChannels; // row length of cellStatistic, at least pNumChannels
 
     std::vector<uint64_t> oneHopRplChildren;
-    std::map<cellLocation_t, CellStatistic> cellStatistic;
     std::map<uint64_t, std::vector<offset_t>> blacklistedSlots;
     std::map<uint64_t, SfControlInfo*> retryInfo; // stores info about outgoing 6P requests to enable retries
     // stores info about nodes for whom downlink has been requested
@@ -538,7 +559,6 @@ class TschMSF: public TschSF, public cListener {
      */
     bool slotOffsetReserved(offset_t slOf);
     bool slotOffsetReserved(uint64_t nodeId, offset_t slOf);
-    bool slOfScheduled(offset_t slOf);
     bool isLossyLink(); // TEST, only for manual lossy link testing
     bool pCheckScheduleConsistency;
 
@@ -550,14 +570,19 @@ class TschMSF: public TschSF, public cListener {
     uint32_t saxHash(int maxReturnVal, InterfaceToken EUI64addr); // TODO: check this, often results in overlapping cells
     void clearCellStats(std::vector<cellLocation_t> cellList);
     std::string printCellUsage(std::string neighborMac, double usage);
-    void updateCellTxStats(cellLocation_t cell, std::string statType);
+    void updateCellTxStats(cellLocation_t cell, tschCellStatType_t statType);
 
-    void removeCell(uint64_t neighbor, cellLocation_t cell, uint8_t cellOptions);
+    /** @return index of @p cell in cellStatistic, growing it to hold the cell if needed */
+    int cellStatIndex(const cellLocation_t &cell);
+    void clearCellStat(const cellLocation_t &cell);
 
-    void updateNeighborStats(uint64_t neighbor, std::string statType);
-    void checkMaxCellsReachedFor(uint64_t neighborId);
+    void removeCell(uint64_t neighbor, cellLocation_t cell, uint8_t cellOptions);
 
-    bool slotOffsetAvailable(offset_t slOf);
+    /** @return handle of @p neighborId in nbrStatistic, a new entry is added on first use */
+    int getNbrStatHandle(uint64_t neighborId);
+    void resetNbrStatistic(uint64_t neighborId);
+    void updateNeighborStats(int handle, tschCellStatType_t statType);
+    void checkMaxCellsReachedFor(int handle);
 
     simsignal_t queueUtilization;
     simsignal_t failed6pAdd; // tracks number of failed 6P ADD requests
@@ -601,6 +626,13 @@ class TschMSF: public TschSF, public cListener {
      */
     std::vector<offset_t> getAvailableSlotsInRange(int start, int end);
     std::vector<offset_t> getAvailableSlotsInRange(int slOffsetEnd);
+    std::vector<offset_t> getAvailableSlotsInRange(const slotBitmap_t &occupied, int start, int end);
+
+    /**
+     * @return bitmap of slot offsets that are scheduled (in TschLinkInfo or in the
+     *         MAC schedule), reserved for an ongoing 6P transaction or used by the auto RX cell
+     */
+    slotBitmap_t getOccupiedSlots();
 
     int pInitNumRx;
 
@@ -156,6 +156,31 @@ public:
     /** Workaround function used to account for cell usage in overlapping links */
     virtual void decrementNeighborCellElapsed(uint64_t neighborId) = 0;
 
+    /** Account for @p numCells cells elapsed at once, e.g. for slots skipped by the MAC in lazy RX mode */
+    virtual void incrementNeighborCellsElapsed(uint64_t neighborId, int numCells) {
+        for (int i = 0; i < numCells; i++)
+            incrementNeighborCellElapsed(neighborId);
+    }
+
+    /**
+     * @brief Handle a per-cell statistics event reported by the MAC on every
+     *        slot and frame exchange. Called directly (no signal lookup),
+     *        so keep it cheap. Ignored by default.
+     *
+     * @param stat           Type of the event, cell coordinates, neighbor and ASN
+     */
+    virtual void handleCellStat(const tschCellStat_t &stat) {}
+
+    /**
+     * @brief Handle a packet for @p destId being enqueued at the MAC, e.g. to
+     *        make sure there is a cell to transmit it. Called directly by the
+     *        MAC for every packet from upper layers, so keep it cheap.
+     *        Ignored by default.
+     *
+     * @param destId         MAC address of the packet destination
+     */
+    virtual void handlePacketEnqueued(uint64_t destId) {}
+
     /**
      * @brief Handle an update from the @ref TschSpectrumSensing module.
      *        These updates will arrive after each completed spectrum sweep.
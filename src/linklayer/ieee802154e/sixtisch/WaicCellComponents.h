@@ -112,6 +112,59 @@ inline bool getCellOptions_isAUTO(uint8_t cellOptions) {
     return cellOptions & MAC_LINKOPTIONS_SRCAUTO;
 }
 
+/**
+ * Set of slot offsets, one bit per slot offset (bit o % 64 of word o / 64).
+ * Offsets beyond the end of the vector count as not set.
+ */
+typedef std::vector<uint64_t> slotBitmap_t;
+
+inline void slotBitmap_set(slotBitmap_t &bitmap, offset_t slotOffset) {
+    if (slotOffset / 64 >= bitmap.size())
+        bitmap.resize(slotOffset / 64 + 1, 0);
+    bitmap[slotOffset / 64] |= (uint64_t) 1 << (slotOffset % 64);
+}
+
+inline void slotBitmap_clear(slotBitmap_t &bitmap, offset_t slotOffset) {
+    if (slotOffset / 64 < bitmap.size())
+        bitmap[slotOffset / 64] &= ~((uint64_t) 1 << (slotOffset % 64));
+}
+
+inline bool slotBitmap_test(const slotBitmap_t &bitmap, offset_t slotOffset) {
+    return slotOffset / 64 < bitmap.size() && (bitmap[slotOffset / 64] >> (slotOffset % 64)) & 1;
+}
+
+/** Adds all slot offsets of @p other to @p bitmap */
+inline void slotBitmap_merge(slotBitmap_t &bitmap, const slotBitmap_t &other) {
+    if (other.size() > bitmap.size())
+        bitmap.resize(other.size(), 0);
+    for (size_t i = 0; i < other.size(); i++)
+        bitmap[i] |= other[i];
+}
+
+/**
+ * @return             slot offsets in [@p start, @p end) NOT set in @p bitmap,
+ *                     in ascending order
+ */
+inline std::vector<offset_t> slotBitmap_unset(const slotBitmap_t &bitmap, int start, int end) {
+    std::vector<offset_t> slots;
+    if (start < 0 || end <= start)
+        return slots;
+
+    for (int word = start / 64; word <= (end - 1) / 64; word++) {
+        uint64_t free = ~(word < (int) bitmap.size() ? bitmap[word] : 0);
+        if (word == start / 64)
+            free &= ~(uint64_t) 0 << (start % 64);
+        if (word == (end - 1) / 64 && end % 64)
+            free &= ~(~(uint64_t) 0 << (end % 64));
+
+        slots.reserve(slots.size() + __builtin_popcountll(free));
+        for (; free; free &= free - 1)
+            slots.push_back((offset_t) (word * 64 + __builtin_ctzll(free)));
+    }
+
+    return slots;
+}
+
 typedef enum {
     INTERFERENCE_PROBABILITY /**< the probability that a link is interfered with. */
 } metricType;
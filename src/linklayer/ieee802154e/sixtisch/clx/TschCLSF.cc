@@ -149,7 +149,7 @@ void TschCLSF::handleSuccessRelocate(uint64_t sender, std::vector<cellLocation_t
     }
 }
 
-vector<offset_t> TschCLSF::getAvailableSlotsInRange(int start, int end, int pad) {
+vector<offset_t> TschCLSF::getAvailableSlotsInRange(const slotBitmap_t &occupied, int start, int end, int pad) {
     // heuristic to loosen the bounds of a slotframe chunk a little
    start -= pad;
    end += pad;
@@ -166,7 +166,7 @@ vector<offset_t> TschCLSF::getAvailableSlotsInRange(int start, int end, int pad)
 
    EV_DETAIL << "CLSF looking for available slots in range: " << start << ", " << end << ", padding = " << pad << endl;
 
-   auto freeSlots = TschMSF::getAvailableSlotsInRange(start, end);
+   auto freeSlots = TschMSF::getAvailableSlotsInRange(occupied, start, end);
 
    EV_DETAIL << "Found free slots: " << freeSlots << endl;
 
@@ -187,24 +187,25 @@ int TschCLSF::createCellList(uint64_t destId, std::vector<cellLocation_t> &cellL
     }
 
     std::vector<offset_t> availableSlots;
+    auto occupied = getOccupiedSlots();
 
     if (isCrossLayerInfoAvailable()) {
-        availableSlots = TschCLSF::getAvailableSlotsInRange(crossLayerSlotRange.start, crossLayerSlotRange.end, slotframeChunkPad);
+        availableSlots = TschCLSF::getAvailableSlotsInRange(occupied, crossLayerSlotRange.start, crossLayerSlotRange.end, slotframeChunkPad);
 
         if (!availableSlots.size()) {
             EV_DETAIL << "No free slots found in the assigned slotframe chunk, searching from 0th slot" << endl;
 
-            availableSlots = TschMSF::getAvailableSlotsInRange(0, crossLayerSlotRange.start);
+            availableSlots = TschMSF::getAvailableSlotsInRange(occupied, 0, crossLayerSlotRange.start);
 
             if (!availableSlots.size()) {
                 EV_DETAIL << "No free slots found from 0th slot, searching across the whole slotframe" << endl;
 
-                availableSlots = TschMSF::getAvailableSlotsInRange(0, pSlotframeLength);
+                availableSlots = TschMSF::getAvailableSlotsInRange(occupied, 0, pSlotframeLength);
             }
         }
     }
     else
-        availableSlots = TschMSF::getAvailableSlotsInRange(0, pSlotframeLength);
+        availableSlots = TschMSF::getAvailableSlotsInRange(occupied, 0, pSlotframeLength);
 
     if (!availableSlots.size()) {
         EV_DETAIL << "No available cells found" << endl;
@@ -54,7 +54,7 @@ private:
     bool isCrossLayerInfoAvailable() { return isValidSlotframeChunk(crossLayerSlotRange) && crossLayerChOffset != -1; }
 
     offset_t chooseCrossLayerChOffset();
-    vector<offset_t> getAvailableSlotsInRange(int start, int end, int pad);
+    vector<offset_t> getAvailableSlotsInRange(const slotBitmap_t &occupied, int start, int end, int pad);
     vector<cellLocation_t> getNonDaisyChainedCells(vector<cellLocation_t> cellList);
 
     // Functions overriden from the MSF
@@ -19,6 +19,8 @@
 #include "inet/common/geometry/base/ShapeBase.h"
 #include "inet/common/geometry/common/RotationMatrix.h"
 #include "inet/common/geometry/object/LineSegment.h"
+#include "inet/mobility/base/StationaryMobilityBase.h"
+#include "inet/mobility/contract/IMobility.h"
 #include "inet/physicallayer/obstacleloss/IdealObstacleLoss.h"
 #include "ReSAObstacleLoss.h"
 
@@ -39,7 +41,45 @@ void ReSAObstacleLoss::initialize(int stage)
         loss = par("loss");
         medium = check_and_cast<IRadioMedium *>(getParentModule());
         physicalEnvironment = getModuleFromPar<IPhysicalEnvironment>(par("physicalEnvironmentModule"), this);
+        cacheSize = par("cacheSize");
+        getSimulation()->getSystemModule()->subscribe(IMobility::mobilityStateChangedSignal, this);
     }
+    else if (stage == INITSTAGE_LAST) {
+        if (par("precomputeLossMatrix"))
+            precomputeLossMatrix();
+    }
+}
+
+void ReSAObstacleLoss::finish()
+{
+    recordScalar("obstacleLossLookups", numLookups);
+    recordScalar("obstacleLossComputations", numComputations);
+}
+
+void ReSAObstacleLoss::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    Enter_Method_Silent();
+    // positions are part of the key, so this only keeps moving nodes from piling up entries
+    if (signalID == IMobility::mobilityStateChangedSignal)
+        lossCache.clear();
+}
+
+void ReSAObstacleLoss::precomputeLossMatrix()
+{
+    std::vector<Coord> positions;
+    for (int id = 0; id <= getSimulation()->getLastComponentId(); id++) {
+        auto mobility = dynamic_cast<StationaryMobilityBase *>(getSimulation()->getModule(id));
+        if (mobility && stationaryPositions.emplace(mobility->getCurrentPosition(), positions.size()).second)
+            positions.push_back(mobility->getCurrentPosition());
+    }
+
+    int numPositions = positions.size();
+    lossMatrix.resize(numPositions * numPositions);
+    for (int i = 0; i < numPositions; i++)
+        for (int j = 0; j < numPositions; j++)
+            lossMatrix[i * numPositions + j] = computeObstacleLossUncached(positions[i], positions[j]);
+
+    EV_INFO << "Precomputed obstacle loss between " << numPositions << " stationary positions" << endl;
 }
 
 std::ostream& ReSAObstacleLoss::printToStream(std::ostream& stream, int level) const
@@ -51,8 +91,10 @@ bool ReSAObstacleLoss::isObstacle(const IPhysicalObject *object, const Coord& tr
 {
     const ShapeBase *shape = object->getShape();
     const Coord& position = object->getPosition();
-    const Quaternion& orientation = object->getOrientation();
-    RotationMatrix rotation(orientation.toEulerAngles());
+    auto it = rotations.find(object);
+    if (it == rotations.end())
+        it = rotations.emplace(object, RotationMatrix(object->getOrientation().toEulerAngles())).first;
+    const RotationMatrix& rotation = it->second;
     const LineSegment lineSegment(rotation.rotateVectorInverse(transmissionPosition - position), rotation.rotateVectorInverse(receptionPosition - position));
     Coord intersection1, intersection2, normal1, normal2;
     bool hasIntersections = shape->computeIntersection(lineSegment, intersection1, intersection2, normal1, normal2);
@@ -66,6 +108,32 @@ bool ReSAObstacleLoss::isObstacle(const IPhysicalObject *object, const Coord& tr
 
 double ReSAObstacleLoss::computeObstacleLoss(Hz frequency, const Coord& transmissionPosition, const Coord& receptionPosition) const
 {
+    numLookups++;
+    if (!lossMatrix.empty()) {
+        auto transmitter = stationaryPositions.find(transmissionPosition);
+        auto receiver = stationaryPositions.find(receptionPosition);
+        if (transmitter != stationaryPositions.end() && receiver != stationaryPositions.end())
+            return lossMatrix[transmitter->second * stationaryPositions.size() + receiver->second];
+    }
+
+    // the loss doesn't depend on the frequency
+    PositionPair key = {transmissionPosition, receptionPosition};
+    auto it = lossCache.find(key);
+    if (it != lossCache.end())
+        return it->second;
+
+    double lossFactor = computeObstacleLossUncached(transmissionPosition, receptionPosition);
+    if (cacheSize > 0) {
+        if ((int) lossCache.size() >= cacheSize)
+            lossCache.clear();
+        lossCache[key] = lossFactor;
+    }
+    return lossFactor;
+}
+
+double ReSAObstacleLoss::computeObstacleLossUncached(const Coord& transmissionPosition, const Coord& receptionPosition) const
+{
+    numComputations++;
     TotalObstacleLossComputation obstacleLossVisitor(this, transmissionPosition, receptionPosition);
     physicalEnvironment->visitObjects(&obstacleLossVisitor, LineSegment(transmissionPosition, receptionPosition));
     return obstacleLossVisitor.isObstacleFound() ? 1/pow(10,loss/10) : 1;
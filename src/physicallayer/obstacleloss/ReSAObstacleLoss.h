@@ -19,11 +19,15 @@
 #define _RESAOBSTACLELOSS_H
 
 #include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "inet/environment/contract/IPhysicalObject.h"
 #include "inet/physicallayer/contract/packetlevel/ITracingObstacleLoss.h"
 #include "inet/common/IVisitor.h"
 #include "inet/common/figures/TrailFigure.h"
+#include "inet/common/geometry/common/RotationMatrix.h"
 #include "inet/environment/contract/IPhysicalEnvironment.h"
 #include "inet/physicallayer/base/packetlevel/TracingObstacleLossBase.h"
 #include "inet/physicallayer/contract/packetlevel/IRadioMedium.h"
@@ -33,9 +37,29 @@ using namespace inet::physicallayer;
 
 namespace tsch {
 
-class ReSAObstacleLoss : public cModule, public IObstacleLoss
+class ReSAObstacleLoss : public cModule, public IObstacleLoss, protected cListener
 {
     protected:
+      /** Transmitter and receiver position, key of the loss cache */
+      struct PositionPair {
+          Coord transmission;
+          Coord reception;
+          bool operator==(const PositionPair& other) const { return transmission == other.transmission && reception == other.reception; }
+      };
+      struct PositionPairHash {
+          size_t operator()(const PositionPair& key) const {
+              std::hash<double> h;
+              return h(key.transmission.x) ^ (h(key.transmission.y) * 31) ^ (h(key.transmission.z) * 961)
+                      ^ (h(key.reception.x) * 29791) ^ (h(key.reception.y) * 923521) ^ (h(key.reception.z) * 28629151);
+          }
+      };
+      struct PositionHash {
+          size_t operator()(const Coord& position) const {
+              std::hash<double> h;
+              return h(position.x) ^ (h(position.y) * 31) ^ (h(position.z) * 961);
+          }
+      };
+
       class TotalObstacleLossComputation : public IVisitor
       {
         protected:
@@ -61,10 +85,39 @@ class ReSAObstacleLoss : public cModule, public IObstacleLoss
       physicalenvironment::IPhysicalEnvironment *physicalEnvironment = nullptr;
       //@}
 
+      /** @name Caches */
+      //@{
+      /**
+       * Loss factor per transmitter / receiver position pair, cleared whenever a node moves
+       */
+      mutable std::unordered_map<PositionPair, double, PositionPairHash> lossCache;
+      /**
+       * Rotation of each physical object, whose inverse maps positions into the object's frame
+       */
+      mutable std::map<const physicalenvironment::IPhysicalObject *, RotationMatrix> rotations;
+      /**
+       * Positions of the stationary nodes and the loss factor between each pair of them,
+       * indexed by transmitter * number of positions + receiver, if precomputed at initialization
+       */
+      std::unordered_map<Coord, int, PositionHash> stationaryPositions;
+      std::vector<double> lossMatrix;
+      //@}
+
+      int cacheSize;
+      mutable long numLookups = 0;
+      mutable long numComputations = 0;
+
   protected:
     double loss;
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
     virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
     virtual bool isObstacle(const physicalenvironment::IPhysicalObject *object, const Coord& transmissionPosition, const Coord& receptionPosition) const;
+    /** Visits the physical environment for obstacles between the two positions */
+    virtual double computeObstacleLossUncached(const Coord& transmissionPosition, const Coord& receptionPosition) const;
+    /** Fills the loss matrix for the positions of all stationary mobility modules */
+    virtual void precomputeLossMatrix();
 
   public:
     ReSAObstacleLoss();
@@ -15,6 +15,10 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include "inet/physicallayer/analogmodel/packetlevel/DimensionalAnalogModel.h"
 #include "inet/physicallayer/analogmodel/packetlevel/DimensionalNoise.h"
 #include "inet/physicallayer/analogmodel/packetlevel/DimensionalReception.h"
@@ -31,6 +35,11 @@ using namespace physicallayer;
 
 namespace tsch {
 
+// Transmit power and interference path loss (IPL = a * distance + b) of the radio altimeters
+static const double P_RA_dBm = 27.78;
+static const double IPL_fun_coe_a = 1.5959;
+static const double IPL_fun_coe_b = 83.7078;
+
 Define_Module(WaicDimensionalAnalogModel);
 
 void WaicDimensionalAnalogModel::initialize(int stage)
@@ -46,21 +55,68 @@ void WaicDimensionalAnalogModel::initialize(int stage)
          //===========================================================================================================
         // Altimeter locations defined by string "AltimeterLocations" in  WaicDimensionalAnalogModel.ned and ini-file
         // Read locations of radio altimeters into vector:
-        V_AltimeterLocation= getAltimeterLocation_v_str();
-
-        //===========================================================================================================
-        // Read time offsets of radio altimeters into vector:
-        RaOffSet=getRaOffSet();
+        auto altimeterLocations = getAltimeterLocation_v_str();
+        for (auto& location : altimeterLocations) {
+            altimeterX.push_back(location.x);
+            altimeterY.push_back(location.y);
+            altimeterZ.push_back(location.z);
+        }
 
         //===========================================================================================================
-        // Read frequency shifts of radio altimeters into vector:
-        Ra_Freq_OffSet=getRa_Freq_OffSet();
+        // Read time offsets and frequency shifts of radio altimeters into vectors,
+        // altimeters without an entry of their own get no offset:
+        for (auto& offset : getRaOffSet())
+            altimeterTimeOffset.push_back(toDouble(offset));
+        altimeterFreqOffset = getRa_Freq_OffSet();
+        if (altimeterTimeOffset.size() < altimeterX.size() || altimeterFreqOffset.size() < altimeterX.size())
+            EV_WARN << "Fewer RA_OffSet or RA_Freq_OffSet entries than altimeters, using 0 for the missing ones" << endl;
+        altimeterTimeOffset.resize(altimeterX.size(), 0);
+        altimeterFreqOffset.resize(altimeterX.size(), 0);
+
+        chirpPhaseStart.resize(altimeterX.size());
+        chirpPhaseStop.resize(altimeterX.size());
+        altimeterInterfering.resize(altimeterX.size());
+        cacheSize = par("cacheSize");
 
         //===========================================================================================================
         // Read chirp parameters of radio altimeters:
         T_chirp=par("T_chirp");
         f_chirp_min=par("f_chirp_min");
         f_chirp_max=par("f_chirp_max");
+        chirpSlope = (f_chirp_max - f_chirp_min) / T_chirp;
+
+        //===========================================================================================================
+        // Altimeters received below minAltimeterPower are culled, those within the resulting
+        // cutoff distance are found through a grid with cells of that size:
+        double minPower = par("minAltimeterPower");
+        minAltimeterPower = std::isnan(minPower) ? 0 : pow(10.0, minPower / 10.0);
+        altimeterCutoffDistance = std::isnan(minPower) ? INFINITY : (P_RA_dBm - IPL_fun_coe_b - minPower) / IPL_fun_coe_a;
+        if (altimeterCutoffDistance <= 0)
+            throw cRuntimeError("minAltimeterPower %g dBm is above the power of any altimeter", minPower);
+        if (std::isfinite(altimeterCutoffDistance)) {
+            for (size_t k = 0; k < altimeterX.size(); k++) {
+                auto cell = std::make_tuple((int) floor(altimeterX[k] / altimeterCutoffDistance),
+                        (int) floor(altimeterY[k] / altimeterCutoffDistance), (int) floor(altimeterZ[k] / altimeterCutoffDistance));
+                altimeterGrid[cell].push_back(k);
+            }
+        }
+
+        chirpTableResolution = par("chirpTableResolution");
+        checkChirpTable = par("checkChirpTable");
+        if (chirpTableResolution < 0)
+            throw cRuntimeError("Invalid chirpTableResolution %d", chirpTableResolution);
+    }
+}
+
+void WaicDimensionalAnalogModel::finish()
+{
+    recordScalar("altimetersEvaluated", numAltimetersEvaluated);
+    recordScalar("altimetersCulled", numAltimetersCulled);
+    recordScalar("constantNoiseListenings", numConstantNoise);
+    recordScalar("compositeNoiseListenings", numCompositeNoise);
+    if (chirpTableResolution > 0) {
+        recordScalar("chirpTableLookups", numChirpTableLookups);
+        recordScalar("chirpTableFallbacks", numChirpTableFallbacks);
     }
 }
 
@@ -91,32 +147,221 @@ const INoise *WaicDimensionalAnalogModel::computeNoise(const IListening *listeni
     simsec startTime = simsec(listening->getStartTime());
     simsec endTime = simsec(listening->getEndTime());
 
-    // should be zero, which causes trouble in division -> choosen value close enough to zero
-    WpHz altimeterPowerSpectralDensity = WpHz(1e-30);
-    // Check all participating RAs
-    for (int k=0; k < V_AltimeterLocation.size(); k++){
-        EV_DEBUG << "V_AltimeterLocation[" <<k <<"] = " << V_AltimeterLocation[k]  << endl;
-
-        auto distToAltimeter = listening->getEndPosition().distance(V_AltimeterLocation[k]);
-
-        if (isAltimeterInterfering(centerFrequency,  bandwidth, startTime, endTime, toDouble(RaOffSet[k]),Ra_Freq_OffSet[k])) {
-            EV_DEBUG << "==============>> Altimeter is interfering:" << endl;
-            altimeterPowerSpectralDensity += WpHz(AltimeterInterferingPower(distToAltimeter)/bandwidth.get());
-            EV_DEBUG << "distance - " << distToAltimeter <<  ", power spectral density = " << altimeterPowerSpectralDensity << endl;
+    WpHz altimeterPowerSpectralDensity = WpHz(computeAltimeterPowerSpectralDensity(listening->getEndPosition(), centerFrequency, bandwidth, startTime, endTime));
+    Hz lowerFrequency = centerFrequency - bandwidth / 2;
+    Hz upperFrequency = centerFrequency + bandwidth / 2;
 
+    //==================================================================================================
+    // Fast path: if background noise and interfering receptions are constant within the listening,
+    // the noise is a single box instead of their sum multiplied by the bandpass filter
+    if (endTime > startTime && bandwidth > Hz(0)) {
+        Interval<simsec, Hz> interval(Point<simsec, Hz>(startTime, lowerFrequency), Point<simsec, Hz>(endTime, upperFrequency), 0b11, 0b00, 0b00);
+        WpHz powerSpectralDensity = WpHz(0);
+        bool constant = true;
+        for (const auto& receptionPower : receptionPowers) {
+            WpHz value = receptionPower->getMin(interval);
+            if (!(value == receptionPower->getMax(interval))) {
+                constant = false;
+                break;
+            }
+            powerSpectralDensity += value;
+        }
+        if (constant) {
+            numConstantNoise++;
+            powerSpectralDensity += altimeterPowerSpectralDensity;
+            const auto& noisePower = makeShared<Boxcar2DFunction<WpHz, simsec, Hz>>(startTime, endTime, lowerFrequency, upperFrequency, powerSpectralDensity);
+            return new DimensionalNoise(listening->getStartTime(), listening->getEndTime(), centerFrequency, bandwidth, noisePower);
         }
     }
+    numCompositeNoise++;
 
     const Ptr<const IFunction<WpHz, Domain<simsec, Hz>>>& altimeterPower =
         makeShared<ConstantFunction<WpHz, Domain<simsec, Hz>>>(altimeterPowerSpectralDensity);
     receptionPowers.push_back(altimeterPower);
 
     const Ptr<const IFunction<WpHz, Domain<simsec, Hz>>>& noisePower = makeShared<SummedFunction<WpHz, Domain<simsec, Hz>>>(receptionPowers);
-    const auto& bandpassFilter = makeShared<Boxcar2DFunction<double, simsec, Hz>>(simsec(listening->getStartTime()), simsec(listening->getEndTime()), centerFrequency - bandwidth / 2, centerFrequency + bandwidth / 2, 1);
+    const auto& bandpassFilter = makeShared<Boxcar2DFunction<double, simsec, Hz>>(startTime, endTime, lowerFrequency, upperFrequency, 1);
 
     return new DimensionalNoise(listening->getStartTime(), listening->getEndTime(), centerFrequency, bandwidth, noisePower->multiply(bandpassFilter));
 }
 
+const WaicDimensionalAnalogModel::ReceiverAltimeters& WaicDimensionalAnalogModel::getReceiverAltimeters(const Coord& position) const
+{
+    PositionKey key = {position.x, position.y, position.z};
+    if (cacheSize > 0) {
+        auto it = receiverAltimeterCache.find(key);
+        if (it != receiverAltimeterCache.end())
+            return it->second;
+
+        if ((int) receiverAltimeterCache.size() >= cacheSize)
+            receiverAltimeterCache.clear();
+    }
+
+    // candidates from the grid cells within the cutoff distance, or all altimeters without a cutoff
+    std::vector<int> candidates;
+    if (!std::isfinite(altimeterCutoffDistance)) {
+        candidates.resize(altimeterX.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+    else {
+        int x0 = floor((position.x - altimeterCutoffDistance) / altimeterCutoffDistance);
+        int y0 = floor((position.y - altimeterCutoffDistance) / altimeterCutoffDistance);
+        int z0 = floor((position.z - altimeterCutoffDistance) / altimeterCutoffDistance);
+        for (int x = x0; x <= x0 + 2; x++)
+            for (int y = y0; y <= y0 + 2; y++)
+                for (int z = z0; z <= z0 + 2; z++) {
+                    auto cell = altimeterGrid.find(std::make_tuple(x, y, z));
+                    if (cell != altimeterGrid.end())
+                        candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+                }
+        // keep the order of AltimeterLocations, so that the powers are summed up in the same order
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    // with caching disabled, collected into scratch space overwritten by the next call
+    ReceiverAltimeters& altimeters = cacheSize > 0 ? receiverAltimeterCache[key] : uncachedAltimeters;
+    altimeters.clear();
+    for (int k : candidates) {
+        double power = AltimeterInterferingPower(position.distance(Coord(altimeterX[k], altimeterY[k], altimeterZ[k])));
+        if (power < minAltimeterPower)
+            continue;
+        altimeters.index.push_back(k);
+        altimeters.timeOffset.push_back(altimeterTimeOffset[k]);
+        altimeters.freqOffset.push_back(altimeterFreqOffset[k]);
+        altimeters.power.push_back(power);
+    }
+
+    return altimeters;
+}
+
+double WaicDimensionalAnalogModel::computeAltimeterPowerSpectralDensity(const Coord& position, Hz centerFrequency, Hz bandwidth, simsec startTime, simsec endTime) const
+{
+    ListeningKey key = {{position.x, position.y, position.z}, centerFrequency.get(), bandwidth.get(), toDouble(startTime), toDouble(endTime)};
+    if (cacheSize > 0) {
+        auto it = altimeterNoiseCache.find(key);
+        if (it != altimeterNoiseCache.end())
+            return it->second;
+    }
+
+    const ReceiverAltimeters& altimeters = getReceiverAltimeters(position);
+    const int numAltimeters = altimeters.index.size();
+    const int *index = altimeters.index.data();
+    const double *timeOffset = altimeters.timeOffset.data();
+    const double *freqOffset = altimeters.freqOffset.data();
+    const double *powers = altimeters.power.data();
+    double *phaseStart = chirpPhaseStart.data();
+    double *phaseStop = chirpPhaseStop.data();
+    signed char *interfering = altimeterInterfering.data();
+
+    numAltimetersEvaluated += numAltimeters;
+    numAltimetersCulled += altimeterX.size() - numAltimeters;
+
+    // Same arithmetic as isAltimeterInterfering(), in branch-free loops over all altimeters
+    // not culled, optionally looked up in the overlap table by chirp phase
+    double t_start = toDouble(startTime);
+    double T_forecast = toDouble(endTime) - t_start;
+    double channelLow = centerFrequency.get() - bandwidth.get() / 2.0;
+    double channelHigh = centerFrequency.get() + bandwidth.get() / 2.0;
+
+    if (T_forecast >= T_chirp) {
+        // single box - full range
+        for (int k = 0; k < numAltimeters; k++)
+            interfering[k] = channelHigh >= f_chirp_min + freqOffset[k] && f_chirp_max + freqOffset[k] >= channelLow;
+    }
+    else if (chirpTableResolution > 0) {
+        const ChirpBin *table = getChirpTable(channelLow, channelHigh);
+        double binsPerSecond = chirpTableResolution / T_chirp;
+        for (int k = 0; k < numAltimeters; k++)
+            phaseStart[k] = fmod(t_start + timeOffset[k], T_chirp);
+        for (int k = 0; k < numAltimeters; k++) {
+            const ChirpBin& bin = table[index[k] * chirpTableResolution + std::min((int) (phaseStart[k] * binsPerSecond), chirpTableResolution - 1)];
+            interfering[k] = T_forecast >= bin.maxDistance ? 1 : T_forecast < bin.minDistance ? 0 : -1;
+        }
+        numChirpTableLookups += numAltimeters;
+        for (int k = 0; k < numAltimeters; k++) {
+            if (interfering[k] >= 0 && !checkChirpTable)
+                continue;
+            bool overlapping = isChirpOverlapping(phaseStart[k], fmod(t_start + timeOffset[k] + T_forecast, T_chirp), freqOffset[k], channelLow, channelHigh);
+            if (interfering[k] < 0)
+                numChirpTableFallbacks++;
+            else if (interfering[k] != overlapping)
+                throw cRuntimeError("Chirp overlap table of altimeter %d disagrees with the analytic test at t=%.12g s, listening %g s, channel [%g, %g] Hz",
+                        index[k], t_start, T_forecast, channelLow, channelHigh);
+            interfering[k] = overlapping;
+        }
+    }
+    else {
+        for (int k = 0; k < numAltimeters; k++) {
+            phaseStart[k] = fmod(t_start + timeOffset[k], T_chirp);
+            phaseStop[k] = fmod(t_start + timeOffset[k] + T_forecast, T_chirp);
+        }
+        for (int k = 0; k < numAltimeters; k++)
+            interfering[k] = isChirpOverlapping(phaseStart[k], phaseStop[k], freqOffset[k], channelLow, channelHigh);
+    }
+
+    // should be zero, which causes trouble in division -> choosen value close enough to zero
+    double powerSpectralDensity = 1e-30;
+    for (int k = 0; k < numAltimeters; k++)
+        powerSpectralDensity += interfering[k] ? powers[k] / bandwidth.get() : 0.0;
+
+    EV_DEBUG << "Altimeter power spectral density at " << position << " on " << centerFrequency << ": " << powerSpectralDensity << " W/Hz" << endl;
+
+    if (cacheSize > 0) {
+        if ((int) altimeterNoiseCache.size() >= cacheSize)
+            altimeterNoiseCache.clear();
+        altimeterNoiseCache[key] = powerSpectralDensity;
+    }
+    return powerSpectralDensity;
+}
+
+const WaicDimensionalAnalogModel::ChirpBin *WaicDimensionalAnalogModel::getChirpTable(double channelLow, double channelHigh) const
+{
+    auto& table = chirpTables[std::make_pair(channelLow, channelHigh)];
+    if (!table.empty())
+        return table.data();
+
+    // phases closer than this to a bin edge or the channel edges are left to the analytic test
+    const double margin = T_chirp * 1e-6;
+    const double binWidth = T_chirp / chirpTableResolution;
+    const ChirpBin ambiguous = {-INFINITY, INFINITY};
+    const ChirpBin never = {INFINITY, INFINITY};
+
+    table.resize(altimeterX.size() * chirpTableResolution);
+    for (size_t k = 0; k < altimeterX.size(); k++) {
+        ChirpBin *bins = table.data() + k * chirpTableResolution;
+        // phases [a, b] at which the sweep is within the channel
+        double a = (channelLow - f_chirp_min - altimeterFreqOffset[k]) / chirpSlope;
+        double b = (channelHigh - f_chirp_min - altimeterFreqOffset[k]) / chirpSlope;
+
+        if (!(chirpSlope > 0) || channelLow <= 0 || std::abs(b) <= margin || std::abs(a - T_chirp) <= margin) {
+            // degenerate chirp, the [0, 0] box of isChirpOverlapping() or the channel just touching the sweep
+            std::fill(bins, bins + chirpTableResolution, ambiguous);
+            continue;
+        }
+        if (b < 0 || a > T_chirp) {
+            std::fill(bins, bins + chirpTableResolution, never);
+            continue;
+        }
+        a = std::max(a, 0.0);
+        b = std::min(b, T_chirp);
+
+        // distance from phase p to the next one within [a, b]
+        auto distance = [&] (double p) { return p < a ? a - p : p <= b ? 0 : T_chirp - p + a; };
+        for (int i = 0; i < chirpTableResolution; i++) {
+            double p0 = i * binWidth;
+            double p1 = i + 1 == chirpTableResolution ? T_chirp : (i + 1) * binWidth;
+            // infimum and supremum over [p0, p1): the distance decreases along the bin, except
+            // for jumping up to a full chirp minus [a, b] right after b
+            double minDistance = p1 > a && p0 <= b ? 0 : distance(p1);
+            double maxDistance = distance(p0);
+            if (p0 <= b && b < p1 && b < T_chirp)
+                maxDistance = std::max(maxDistance, T_chirp - b + a);
+            bins[i] = {minDistance - margin, maxDistance + margin};
+        }
+    }
+    return table.data();
+}
+
 const Coord& WaicDimensionalAnalogModel::getAltimeterLocation() const {
     std::vector<Coord> V_AltimeterLocation;
     // Find NED network module
@@ -373,9 +618,7 @@ const bool WaicDimensionalAnalogModel::isAltimeterInterfering(Hz centerFrequency
 
 const double WaicDimensionalAnalogModel::AltimeterInterferingPower(double distance) const {
 
-    double ipl_dB=0, IPL_fun_coe_a=1.5959,
-           IPL_fun_coe_b=83.7078, P_RA_dBm=27.78,
-            P_rx_lin, P_rx_dB;
+    double ipl_dB=0, P_rx_lin, P_rx_dB;
 
     ipl_dB=IPL_fun_coe_a * distance + IPL_fun_coe_b;
     P_rx_dB=P_RA_dBm - ipl_dB;
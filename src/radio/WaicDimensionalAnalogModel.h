@@ -18,6 +18,11 @@
 #ifndef __WAICDIMENSIONALANALOGMODEL_H
 #define __WAICDIMENSIONALANALOGMODEL_H
 
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
 #include "inet/physicallayer/analogmodel/packetlevel/DimensionalAnalogModel.h"
 
 namespace tsch {
@@ -31,15 +36,121 @@ class WaicDimensionalAnalogModel : public DimensionalAnalogModel
   protected:
     virtual void initialize(int stage) override;
     virtual int numInitStages() const override { return NUM_INIT_STAGES; };
+    virtual void finish() override;
 
   private:
+    /** Exact position of a receiver, key of the per-receiver caches */
+    struct PositionKey {
+        double x, y, z;
+        bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+    };
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& key) const {
+            std::hash<double> h;
+            return h(key.x) ^ (h(key.y) * 31) ^ (h(key.z) * 961);
+        }
+    };
+    /** Receiver position, channel and listening interval */
+    struct ListeningKey {
+        PositionKey position;
+        double centerFrequency, bandwidth;
+        double startTime, endTime;
+        bool operator==(const ListeningKey& other) const {
+            return position == other.position && centerFrequency == other.centerFrequency && bandwidth == other.bandwidth
+                    && startTime == other.startTime && endTime == other.endTime;
+        }
+    };
+    struct ListeningKeyHash {
+        size_t operator()(const ListeningKey& key) const {
+            std::hash<double> h;
+            return PositionKeyHash()(key.position) ^ (h(key.centerFrequency) * 29791) ^ (h(key.bandwidth) * 923521)
+                    ^ h(key.startTime) ^ (h(key.endTime) * 31);
+        }
+    };
+
+    /**
+     * Chirp phase distance [s] from a start phase within a bin of the overlap table to the
+     * next phase at which the altimeter sweeps across the channel, i.e. listenings starting
+     * within the bin and lasting at least maxDistance are interfered with, those shorter
+     * than minDistance are not; anything in between is left to the analytic test
+     */
+    struct ChirpBin {
+        double minDistance, maxDistance;
+    };
+
+    /** Altimeters relevant at a receiver position, as structure of arrays */
+    struct ReceiverAltimeters {
+        std::vector<int> index;          // into AltimeterLocations
+        std::vector<double> timeOffset;  // [s]
+        std::vector<double> freqOffset;  // [Hz]
+        std::vector<double> power;       // received power [W]
+
+        void clear() { index.clear(); timeOffset.clear(); freqOffset.clear(); power.clear(); }
+    };
+
     Coord altimeterLocation;
-    std::vector<Coord> V_AltimeterLocation;
-    std::vector<simtime_t> RaOffSet;
-    std::vector<double> Ra_Freq_OffSet;
+    // Radio altimeters as structure of arrays, index k is the k-th entry of AltimeterLocations
+    std::vector<double> altimeterX;
+    std::vector<double> altimeterY;
+    std::vector<double> altimeterZ;
+    std::vector<double> altimeterTimeOffset;  // RA_OffSet [s]
+    std::vector<double> altimeterFreqOffset;  // RA_Freq_OffSet [Hz]
     double T_chirp;
     double f_chirp_min;
     double f_chirp_max;
+    double chirpSlope;  // sweep rate [Hz/s]
+    int cacheSize;
+    double minAltimeterPower;  // [W], altimeters received below it are culled
+    double altimeterCutoffDistance;  // [m], infinite if none are culled
+    // Altimeters by grid cell of altimeterCutoffDistance edge length, unused if none are culled
+    std::map<std::tuple<int, int, int>, std::vector<int>> altimeterGrid;
+    int chirpTableResolution;  // phase bins per chirp, 0 if the overlap table is disabled
+    bool checkChirpTable;
+
+    // Altimeters not culled, per receiver position
+    mutable std::unordered_map<PositionKey, ReceiverAltimeters, PositionKeyHash> receiverAltimeterCache;
+    // Altimeters of the last receiver position if cacheSize is 0
+    mutable ReceiverAltimeters uncachedAltimeters;
+    // Altimeter power spectral density [W/Hz] per receiver position, channel and listening interval
+    mutable std::unordered_map<ListeningKey, double, ListeningKeyHash> altimeterNoiseCache;
+    // Scratch space of computeAltimeterPowerSpectralDensity(), one entry per altimeter
+    mutable std::vector<double> chirpPhaseStart;
+    mutable std::vector<double> chirpPhaseStop;
+    mutable std::vector<signed char> altimeterInterfering;  // -1: left to the analytic test
+    // Overlap table per channel (lower and upper edge [Hz]), chirpTableResolution bins per altimeter
+    mutable std::map<std::pair<double, double>, std::vector<ChirpBin>> chirpTables;
+    mutable long numChirpTableLookups = 0;
+    mutable long numChirpTableFallbacks = 0;
+    mutable long numAltimetersEvaluated = 0;
+    mutable long numAltimetersCulled = 0;
+    mutable long numConstantNoise = 0;   // noise computed as a single box
+    mutable long numCompositeNoise = 0;  // noise computed as sum of functions
+
+    /**
+     * Overlap test of isAltimeterInterfering() for a listening within the same chirp,
+     * given the chirp phases [s] at its start and end: two frequency boxes if the chirp
+     * wraps around within the listening, otherwise a single one with the second one left at [0, 0]
+     */
+    bool isChirpOverlapping(double phaseStart, double phaseStop, double freqOffset, double channelLow, double channelHigh) const {
+        bool wraps = phaseStop < phaseStart;
+        double sweepStart = f_chirp_min + freqOffset + chirpSlope * phaseStart;
+        double sweepStop = f_chirp_min + freqOffset + chirpSlope * phaseStop;
+        double low0 = wraps ? f_chirp_min + freqOffset : sweepStart;
+        double low1 = wraps ? sweepStart : 0.0;
+        double high1 = wraps ? f_chirp_max + freqOffset : 0.0;
+        return (channelHigh >= low0 && sweepStop >= channelLow) | (channelHigh >= low1 && high1 >= channelLow);
+    }
+    /** Returns the overlap table of the given channel, built on its first use */
+    const ChirpBin *getChirpTable(double channelLow, double channelHigh) const;
+
+    /** Returns the altimeters received at @p position with at least minAltimeterPower */
+    const ReceiverAltimeters& getReceiverAltimeters(const Coord& position) const;
+    /**
+     * Sums up the power spectral density [W/Hz] of all relevant altimeters sweeping across the
+     * given channel while listening at @p position, evaluating the same overlap test
+     * as isAltimeterInterfering() for all altimeters at once
+     */
+    double computeAltimeterPowerSpectralDensity(const Coord& position, Hz centerFrequency, Hz bandwidth, simsec startTime, simsec endTime) const;
 
   public:
     virtual const INoise *computeNoise(const IListening *listening, const IInterference *interference) const override;